@@ -29,6 +29,7 @@ const Bitboard RankBB[RANK_NB] = {
 };
 
 Bitboard BetweenBB[64][64];
+Bitboard LineBB[64][64];
 
 static Bitboard BishopAttacks[5248];
 static Bitboard RookAttacks[102400];
@@ -131,7 +132,8 @@ CONSTR(2, InitBitboards)
         for (Square sq2 = A1; sq2 <= H8; sq2++)
             for (PieceType pt = BISHOP; pt <= ROOK; pt++)
                 if (AttackBB(pt, sq1, BB(sq2)) & BB(sq2))
-                    BetweenBB[sq1][sq2] = AttackBB(pt, sq1, BB(sq2)) & AttackBB(pt, sq2, BB(sq1));
+                    BetweenBB[sq1][sq2] = AttackBB(pt, sq1, BB(sq2)) & AttackBB(pt, sq2, BB(sq1)),
+                    LineBB[sq1][sq2] = (AttackBB(pt, sq1, 0) & AttackBB(pt, sq2, 0)) | BB(sq1) | BB(sq2);
 
     for (Square sq = A1; sq <= H8; ++sq) {
 
@@ -111,6 +111,7 @@ extern const Bitboard FileBB[FILE_NB];
 extern const Bitboard RankBB[RANK_NB];
 
 extern Bitboard BetweenBB[64][64];
+extern Bitboard LineBB[64][64];
 
 extern Magic Magics[64][2];
 
@@ -227,3 +228,30 @@ bool KingAttacked(const Position *pos, Color color);
 INLINE Bitboard Checkers(const Position *pos) {
     return colorBB(!sideToMove) & Attackers(pos, kingSq(sideToMove), pieceBB(ALL));
 }
+
+// Pieces of either color that alone shield the king on kingSq from one of the given sliders
+INLINE Bitboard Blockers(const Position *pos, const Square kingSq, const Bitboard sliders) {
+
+    Bitboard snipers = sliders
+                     & (  (AttackBB(BISHOP, kingSq, 0) & (pieceBB(BISHOP) | pieceBB(QUEEN)))
+                        | (AttackBB(ROOK,   kingSq, 0) & (pieceBB(ROOK)   | pieceBB(QUEEN))));
+    Bitboard blockers = 0;
+
+    while (snipers) {
+        Bitboard between = BetweenBB[kingSq][PopLsb(&snipers)] & pieceBB(ALL);
+        if (Single(between))
+            blockers |= between;
+    }
+
+    return blockers;
+}
+
+// Pieces of the side to move that alone shield their king from an enemy slider
+INLINE Bitboard Pinned(const Position *pos) {
+    return colorBB(sideToMove) & Blockers(pos, kingSq(sideToMove), colorBB(!sideToMove));
+}
+
+// Pieces of the side to move that alone shield the enemy king from one of its sliders
+INLINE Bitboard Discoverers(const Position *pos) {
+    return colorBB(sideToMove) & Blockers(pos, kingSq(!sideToMove), colorBB(sideToMove));
+}
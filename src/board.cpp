@@ -17,6 +17,7 @@
 */
 
 #include <ctype.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -222,10 +223,64 @@ static void InitCastlingRight(Position *pos, Color color, int file) {
     RookSquare[cr] = rFrom;
 }
 
+// Zeroes a position, keeping its history buffer
+static void ClearPosition(Position *pos) {
+
+    History *history = pos->gameHistory;
+    int historySize = pos->historySize;
+
+    memset(pos, 0, sizeof(Position));
+
+    pos->gameHistory = history;
+    pos->historySize = historySize;
+}
+
+// Makes room for at least the given number of history entries
+void ReserveHistory(Position *pos, int entries) {
+
+    if (entries <= pos->historySize)
+        return;
+
+    pos->historySize = MAX(entries, 2 * pos->historySize);
+    pos->gameHistory = (History *)realloc(pos->gameHistory, pos->historySize * sizeof(History));
+
+    if (!pos->gameHistory) {
+        printf("Failed to allocate %d history entries.\n", pos->historySize);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Releases the history buffer of a position that is no longer used
+void FreePosition(Position *pos) {
+    free(pos->gameHistory);
+    pos->gameHistory = NULL;
+    pos->historySize = 0;
+}
+
+// Copies a position and the history in use into dst's own history,
+// leaving room for a search from it
+void CopyPosition(Position *dst, const Position *src) {
+
+    History *history = dst->gameHistory;
+    int historySize = dst->historySize;
+
+    memcpy(dst, src, sizeof(Position));
+
+    dst->gameHistory = history;
+    dst->historySize = historySize;
+
+    ReserveHistory(dst, src->histPly + SEARCH_HISTORY);
+
+    if (src->histPly)
+        memcpy(dst->gameHistory, src->gameHistory, src->histPly * sizeof(History));
+}
+
 // Parse FEN and set up the position as described
 void ParseFen(const char *fen, Position *pos) {
 
-    memset(pos, 0, sizeof(Position));
+    ClearPosition(pos);
+    ReserveHistory(pos, SEARCH_HISTORY);
+
     char c, *copy = strdup(fen);
     char *token = strtok(copy, " ");
 
@@ -273,6 +328,7 @@ void ParseFen(const char *fen, Position *pos) {
 
     // Final initializations
     pos->checkers = Checkers(pos);
+    pos->pinned = Pinned(pos);
     pos->key = GenPosKey(pos);
     pos->materialKey = GenMaterialKey(pos);
     pos->minorKey = GenMinorKey(pos);
@@ -280,12 +336,53 @@ void ParseFen(const char *fen, Position *pos) {
     pos->nonPawnKey[WHITE] = GenNonPawnKey(pos, WHITE);
     pos->nonPawnKey[BLACK] = GenNonPawnKey(pos, BLACK);
     pos->phase = UpdatePhase(pos->phaseValue);
+    NNUERefresh(pos);
 
     free(copy);
 
     assert(PositionOk(pos));
 }
 
+// Packs the pieces and side to move of a position
+void PackPosition(const Position *pos, PackedPos *packed) {
+
+    memset(packed, 0, sizeof(PackedPos));
+    packed->occupied = pieceBB(ALL);
+    packed->stm = sideToMove;
+
+    Bitboard pieces = pieceBB(ALL);
+    for (int i = 0; pieces; ++i) {
+        Square sq = PopLsb(&pieces);
+        packed->pieces[i / 2] |= pieceOn(sq) << (4 * (i & 1));
+    }
+}
+
+// Sets up a position from a packed one, without castling, en passant or
+// history. Unlike ParseFen it touches no global state, so threads can use it
+void UnpackPosition(const PackedPos *packed, Position *pos) {
+
+    ClearPosition(pos);
+
+    Bitboard pieces = packed->occupied;
+    for (int i = 0; pieces; ++i) {
+        Square sq = PopLsb(&pieces);
+        AddPiece(pos, sq, (packed->pieces[i / 2] >> (4 * (i & 1))) & 0xF);
+    }
+
+    sideToMove = packed->stm;
+
+    pos->checkers = Checkers(pos);
+    pos->pinned = Pinned(pos);
+    pos->key = GenPosKey(pos);
+    pos->materialKey = GenMaterialKey(pos);
+    pos->minorKey = GenMinorKey(pos);
+    pos->majorKey = GenMajorKey(pos);
+    pos->nonPawnKey[WHITE] = GenNonPawnKey(pos, WHITE);
+    pos->nonPawnKey[BLACK] = GenNonPawnKey(pos, BLACK);
+    pos->phase = UpdatePhase(pos->phaseValue);
+    NNUERefresh(pos);
+}
+
 // Translates a move to a string
 char *BoardToFen(const Position *pos) {
 
@@ -413,6 +510,74 @@ bool SEE(const Position *pos, const Move move, const int threshold) {
     return side != ColorOf(pieceOn(from));
 }
 
+// Static Exchange Evaluation returning the value of the exchange, using a swap
+// list so it can be worked out once and compared against several thresholds
+int SEEValue(const Position *pos, const Move move) {
+
+    assert(MoveIsPseudoLegal(pos, move));
+    assert(!moveIsSpecial(move));
+
+    Square to = toSq(move);
+    Square from = fromSq(move);
+
+    // Gains of each capture in the sequence for the side making it
+    int gain[32];
+    int d = 0;
+    gain[0] = SEEValues[PieceTypeOf(pieceOn(to))];
+
+    Bitboard occupied = pieceBB(ALL) ^ BB(from);
+    Bitboard attackers = Attackers(pos, to, occupied);
+
+    Bitboard bishops = pieceBB(BISHOP) | pieceBB(QUEEN);
+    Bitboard rooks   = pieceBB(ROOK  ) | pieceBB(QUEEN);
+
+    PieceType onTo = PieceTypeOf(pieceOn(from));
+    Color side = !ColorOf(pieceOn(from));
+
+    // Make captures until one side runs out
+    while (true) {
+
+        // Remove used pieces from attackers
+        attackers &= occupied;
+
+        Bitboard myAttackers = attackers & colorBB(side);
+        if (!myAttackers) break;
+
+        // Pick next least valuable piece to capture with
+        PieceType pt;
+        for (pt = PAWN; pt < KING; ++pt)
+            if (myAttackers & pieceBB(pt))
+                break;
+
+        // The king can't capture a defended piece
+        if (pt == KING && (attackers & colorBB(!side)))
+            break;
+
+        ++d;
+        gain[d] = SEEValues[onTo] - gain[d-1];
+        onTo = pt;
+
+        // Remove the used piece from occupied
+        occupied ^= BB(Lsb(myAttackers & pieceBB(pt)));
+
+        // Add possible discovered attacks from behind the used piece
+        if (pt == PAWN || pt == BISHOP || pt == QUEEN)
+            attackers |= AttackBB(BISHOP, to, occupied) & bishops;
+        if (pt == ROOK || pt == QUEEN)
+            attackers |= AttackBB(ROOK, to, occupied) & rooks;
+
+        side = !side;
+    }
+
+    // Each side can stop capturing when continuing loses material
+    while (d > 0) {
+        gain[d-1] = -MAX(-gain[d-1], gain[d]);
+        --d;
+    }
+
+    return gain[0];
+}
+
 static Key cuckoo[8192];
 static Move cuckooMove[8192];
 
@@ -461,7 +626,7 @@ CONSTR(3, InitCuckoo) {
 // Upcoming repetition detection
 bool HasCycle(const Position *pos, int ply) {
 
-    for (int i = 3; i <= pos->rule50; i += 2) {
+    for (int i = 3; i <= pos->rule50 && i <= pos->histPly; i += 2) {
 
         const History *prev = &history(-i);
         uint32_t j;
@@ -481,7 +646,7 @@ bool HasCycle(const Position *pos, int ply) {
             if (ColorOf(pieceOn(from) ?: pieceOn(to)) != sideToMove)
                 continue;
 
-            for (int k = i + 4; k <= pos->rule50; k += 2) {
+            for (int k = i + 4; k <= pos->rule50 && k <= pos->histPly; k += 2) {
                 const History *prev2 = &history(-k);
                 if (prev2->key == prev->key)
                     return true;
@@ -532,7 +697,7 @@ static Key GenPawnKey(const Position *pos) {
 // Check board state makes sense
 bool PositionOk(const Position *pos) {
 
-    assert(0 <= pos->histPly && pos->histPly < 256);
+    assert(0 <= pos->histPly && pos->histPly <= pos->historySize);
 
     int counts[PIECE_NB] = { 0 };
     int nonPawnCount[COLOR_NB] = { 0, 0 };
@@ -573,6 +738,10 @@ bool PositionOk(const Position *pos) {
 
     assert(!KingAttacked(pos, !sideToMove));
 
+    assert(Pinned(pos) == pos->pinned);
+
+    assert(NNUEAccumulatorOk(pos));
+
     return true;
 }
 #endif
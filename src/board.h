@@ -18,51 +18,95 @@
 
 #pragma once
 
+#include <stddef.h>
+
+#include "nnue.h"
 #include "types.h"
 
 
+// The part of Position that moves change. With COPY_MAKE a copy is kept in
+// the history of each ply and put back on takeback instead of undoing the move
+#define POSITION_STATE          \
+    uint8_t board[64];          \
+    Bitboard pieceBB[7];        \
+    Bitboard colorBB[COLOR_NB]; \
+    Bitboard checkers;          \
+    Bitboard pinned;            \
+                                \
+    int nonPawnCount[COLOR_NB]; \
+    int material;               \
+    int phaseValue;             \
+    int phase;                  \
+                                \
+    Color stm;                  \
+    Square epSquare;            \
+    int rule50;                 \
+    int castlingRights;         \
+                                \
+    Key key;                    \
+    Key materialKey;            \
+    Key pawnKey;                \
+    Key minorKey;               \
+    Key majorKey;               \
+    Key nonPawnKey[COLOR_NB];
+
+typedef struct PositionState {
+    POSITION_STATE
+} PositionState;
+
 typedef struct {
     Key key;
+    Move move;
+
+    // Squares each piece type would check the enemy king from and the pieces
+    // that can uncover a check, set by the first move made from the position
+    Key checkKey;
+    Bitboard checkSquares[TYPE_NB];
+    Bitboard discoverers;
+
+#ifdef COPY_MAKE
+    PositionState state;
+#else
     Key materialKey;
     Bitboard checkers;
-    Move move;
+    Bitboard pinned;
     Square epSquare;
     int rule50;
     int castlingRights;
+#endif
 } History;
 
 typedef struct Position {
-    uint8_t board[64];
-    Bitboard pieceBB[7];
-    Bitboard colorBB[COLOR_NB];
-    Bitboard checkers;
-
-    int nonPawnCount[COLOR_NB];
-    int material;
-    int phaseValue;
-    int phase;
-
-    Color stm;
-    Square epSquare;
-    int rule50;
-    int castlingRights;
+    POSITION_STATE
 
     uint16_t histPly;
     uint16_t gameMoves;
 
-    Key key;
-    Key materialKey;
-    Key pawnKey;
-    Key minorKey;
-    Key majorKey;
-    Key nonPawnKey[COLOR_NB];
-
     uint64_t nodes;
     int trend;
 
-    History gameHistory[256];
+    // Kept out of line and grown as the game goes on, so
+    // copying a position only touches the plies in use
+    History *gameHistory;
+    int historySize;
+
+    Accumulator acc;
 } Position;
 
+static_assert(offsetof(Position, histPly) == sizeof(PositionState), "Position must start with its state");
+
+// History entries reserved past the root for the search to use
+#define SEARCH_HISTORY 128
+
+// Just what the eval needs, the occupied squares and a nibble per piece
+// in square order. 32 bytes, so millions fit in memory where Positions don't
+typedef struct PackedPos {
+    Bitboard occupied;
+    uint8_t pieces[16];
+    uint8_t stm;
+    uint8_t padding[7];
+} PackedPos;
+
 
 extern bool Chess960;
 
@@ -79,10 +123,16 @@ extern Square RookSquare[16];
 
 
 void ParseFen(const char *fen, Position *pos);
+void ReserveHistory(Position *pos, int entries);
+void FreePosition(Position *pos);
+void CopyPosition(Position *dst, const Position *src);
 Key KeyAfter(const Position *pos, Move move);
 bool SEE(const Position *pos, const Move move, const int threshold);
+int SEEValue(const Position *pos, const Move move);
 bool HasCycle(const Position *pos, int ply);
 char *BoardToFen(const Position *pos);
+void PackPosition(const Position *pos, PackedPos *packed);
+void UnpackPosition(const PackedPos *packed, Position *pos);
 #ifndef NDEBUG
 void PrintBoard(const Position *pos);
 bool PositionOk(const Position *pos);
@@ -36,10 +36,13 @@ static Key GenMaterialKey(const char *white, const char *black) {
     char fen[64];
     sprintf(fen, "%s%c/8/8/8/8/8/8/%s%c w - - 0 1", black, (char)(8 - strlen(black) + '0'), white, (char)(8 - strlen(white) + '0'));
 
-    Position pos;
+    Position pos = {};
     ParseFen(fen, &pos);
 
-    return pos.materialKey;
+    Key key = pos.materialKey;
+    FreePosition(&pos);
+
+    return key;
 }
 
 static int TrivialDraw(__attribute__((unused)) const Position *pos, __attribute__((unused)) Color color) {
@@ -0,0 +1,53 @@
+/*
+  Weiss is a UCI compliant chess engine.
+  Copyright (C) 2023 Terje Kirstihagen
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "evalbatch.h"
+#include "evaluate.h"
+#include "threads.h"
+
+
+static const PackedPos *batchPositions;
+static int16_t *batchEvals;
+static size_t batchCount;
+
+
+// Evaluates one thread's share of the batch
+static void *EvalBatchSlice(void *voidThread) {
+
+    Thread *thread = (Thread *)voidThread;
+    Position *pos = &thread->pos;
+
+    size_t begin = batchCount *  thread->index      / thread->count;
+    size_t end   = batchCount * (thread->index + 1) / thread->count;
+
+    for (size_t i = begin; i < end; ++i) {
+        UnpackPosition(&batchPositions[i], pos);
+        batchEvals[i] = EvalPositionWhitePov(pos, &thread->pawnCache, thread->materialCache);
+    }
+
+    return NULL;
+}
+
+void EvalBatch(const PackedPos *positions, size_t count, int16_t *evals) {
+
+    batchPositions = positions;
+    batchEvals = evals;
+    batchCount = count;
+
+    RunWithAllThreads(EvalBatchSlice);
+}
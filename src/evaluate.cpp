@@ -18,13 +18,17 @@
 
 #include <stdlib.h>
 
-#include "tuner/tuner.h"
+#if defined(__AVX2__) && defined(SIMD_EVAL)
+#include <immintrin.h>
+#endif
+
 #include "bitboard.h"
 #include "evaluate.h"
 #include "endgame.h"
 
 
 typedef struct EvalInfo {
+    PawnEntry pawns;
     Bitboard attackedBy[COLOR_NB][TYPE_NB];
     Bitboard passedPawns;
     Bitboard mobilityArea[COLOR_NB];
@@ -33,6 +37,14 @@ typedef struct EvalInfo {
     int16_t attackCount[COLOR_NB];
 } EvalInfo;
 
+// Trace of the evaluation in progress, only written to when Trace is set
+static thread_local EvalTrace T;
+
+#define TraceCount(term)   do { if (Trace) T.term[color] += count; } while (0)
+#define TraceIncr(term)    do { if (Trace) T.term[color]++;        } while (0)
+#define TraceScale(s)      do { if (Trace) T.scale = s;            } while (0)
+#define TraceEval(e)       do { if (Trace) T.eval = e;             } while (0)
+#define TraceDanger(d)     do { if (Trace) T.danger[color] = d;    } while (0)
 
 // Phase value for each piece [piecetype]
 const int PhaseValue[TYPE_NB] = { 0, 0, 1, 1, 2, 4, 0, 0 };
@@ -143,6 +155,7 @@ const int CountModifier[8] = { 0, 0, 63, 126, 96, 124, 124, 128 };
 
 
 // Evaluates pawns
+template <bool Trace>
 INLINE int EvalPawns(const Position *pos, EvalInfo *ei, const Color color) {
 
     const Direction down = color == WHITE ? SOUTH : NORTH;
@@ -215,28 +228,175 @@ INLINE int EvalPawns(const Position *pos, EvalInfo *ei, const Color color) {
     return eval;
 }
 
-// Tries to get pawn eval from cache, otherwise evaluates and saves
-static int ProbePawnCache(const Position *pos, EvalInfo *ei, PawnCache pc) {
+// Evaluates the pawns and fills in the rest of the pawn-derived data
+template <bool Trace>
+static void InitPawnEntry(const Position *pos, EvalInfo *ei, PawnEntry *pe) {
+
+    ei->passedPawns = 0;
 
-    // Can't cache when tuning as full trace is needed
-    if (TRACE) return EvalPawns(pos, ei, WHITE) - EvalPawns(pos, ei, BLACK);
+    pe->eval = EvalPawns<Trace>(pos, ei, WHITE) - EvalPawns<Trace>(pos, ei, BLACK);
+    pe->passedPawns = ei->passedPawns;
+
+    for (Color color = WHITE; color <= BLACK; ++color) {
+        const Direction down = color == WHITE ? SOUTH : NORTH;
+        pe->pawnAttacks[color]     = PawnBBAttackBB(colorPieceBB(color, PAWN), color);
+        pe->pawnsAhead[color]    = Fill(pieceBB(PAWN), down);
+        pe->ownPawnsAhead[color] = Fill(colorPieceBB(color, PAWN), down);
+    }
+}
+
+// Upper half of the pawn key xored with the data of the entry
+INLINE uint32_t PawnCheck(Key key, const PawnEntry *pe) {
+    Bitboard data =  pe->passedPawns
+                   ^ pe->pawnAttacks[WHITE]     ^ pe->pawnAttacks[BLACK]
+                   ^ pe->pawnsAhead[WHITE]    ^ pe->pawnsAhead[BLACK]
+                   ^ pe->ownPawnsAhead[WHITE] ^ pe->ownPawnsAhead[BLACK];
+    return (key >> 32) ^ (uint32_t)data ^ (uint32_t)(data >> 32) ^ (uint32_t)pe->eval;
+}
+
+// Tries to get pawn data from cache, otherwise evaluates and saves.
+// The entry is copied out before being validated, so a concurrent
+// write from another thread can never be half read
+template <bool Trace>
+static int ProbePawnCache(const Position *pos, EvalInfo *ei, PawnCache *pc) {
+
+    PawnEntry *pe = &ei->pawns;
+
+    // Can't cache when tracing as every term needs to be counted
+    if (Trace || !pc) return InitPawnEntry<Trace>(pos, ei, pe), pe->eval;
 
     Key key = pos->pawnKey;
-    PawnEntry *pe = &pc[key % PAWN_CACHE_SIZE];
+    PawnEntry *entry = &pc->table[key & pc->mask];
+
+    *pe = *entry;
 
-    if (pe->key != key) {
-        pe->key  = key;
-        pe->eval = EvalPawns(pos, ei, WHITE) - EvalPawns(pos, ei, BLACK);
-        pe->passedPawns = ei->passedPawns;
+    if (pe->check != PawnCheck(key, pe)) {
+        InitPawnEntry<Trace>(pos, ei, pe);
+        pe->check = PawnCheck(key, pe);
+        *entry = *pe;
     }
 
     return ei->passedPawns = pe->passedPawns, pe->eval;
 }
 
+// Most pieces of one type a side can have, rounded up to whole vectors of 4
+#define MAX_PIECES 12
+
+// Attack and square counts of the pieces of one type, see PieceAttacks()
+typedef struct PieceAttackInfo {
+    Bitboard attacks[MAX_PIECES];
+    int64_t mobility[MAX_PIECES];
+    int64_t kingAttacks[MAX_PIECES];
+    int64_t checks[MAX_PIECES];
+} PieceAttackInfo;
+
+// AVX2 kernels computing the attacks of 4 pieces at a time with Kogge-Stone fills.
+// Opt-in with -DSIMD_EVAL as they measured slower than the pext or magic lookups
+#if defined(__AVX2__) && defined(SIMD_EVAL)
+
+INLINE __m256i ShiftX4(__m256i v, int shift) {
+    return shift > 0 ? _mm256_sll_epi64(v, _mm_cvtsi32_si128( shift))
+                     : _mm256_srl_epi64(v, _mm_cvtsi32_si128(-shift));
+}
+
+// Attacks of 4 sliders, one per lane, in one direction. Kogge-Stone fill through
+// the empty squares, wrap masks out the squares a shift wraps around to
+INLINE __m256i FillX4(__m256i gen, Bitboard empty, int shift, Bitboard wrap) {
+    __m256i pro = _mm256_set1_epi64x(empty & wrap);
+    gen = _mm256_or_si256(gen, _mm256_and_si256(pro, ShiftX4(gen, shift)));
+    pro = _mm256_and_si256(pro, ShiftX4(pro, shift));
+    gen = _mm256_or_si256(gen, _mm256_and_si256(pro, ShiftX4(gen, 2 * shift)));
+    pro = _mm256_and_si256(pro, ShiftX4(pro, 2 * shift));
+    gen = _mm256_or_si256(gen, _mm256_and_si256(pro, ShiftX4(gen, 4 * shift)));
+    return _mm256_and_si256(ShiftX4(gen, shift), _mm256_set1_epi64x(wrap));
+}
+
+// Popcount of each lane, using a nibble lookup
+INLINE __m256i PopCountX4(__m256i v) {
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    __m256i lo = _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, nibble));
+    __m256i hi = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+    return _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256());
+}
+
+#endif
+
+// Finds the x-ray attacks of all pieces of a type, and how many squares of
+// the mobility area, enemy king zone and checking squares each one attacks
+INLINE void PieceAttacks(const Position *pos, const EvalInfo *ei, const Color color, const PieceType pt,
+                         const Square *squares, int count, PieceAttackInfo *pai) {
+
+    Bitboard mobilityArea = ei->mobilityArea[color];
+    Bitboard kingZone     = ei->kingZone[!color];
+    Bitboard checkSquares = AttackBB(pt, kingSq(!color), pieceBB(ALL));
+
+#if defined(__AVX2__) && defined(SIMD_EVAL)
+
+    Bitboard occ = pieceBB(ALL) ^ pieceBB(QUEEN);
+    if (pt == BISHOP || pt == QUEEN) occ ^= colorPieceBB(color, BISHOP);
+    if (pt == ROOK   || pt == QUEEN) occ ^= colorPieceBB(color, ROOK);
+
+    const Bitboard notA = ~fileABB, notH = ~fileHBB;
+
+    for (int i = 0; i < count; i += 4) {
+
+        __m256i attacks;
+
+        if (pt == KNIGHT)
+            attacks = _mm256_setr_epi64x(AttackBB(KNIGHT, squares[i+0], 0),
+                                         i+1 < count ? AttackBB(KNIGHT, squares[i+1], 0) : 0,
+                                         i+2 < count ? AttackBB(KNIGHT, squares[i+2], 0) : 0,
+                                         i+3 < count ? AttackBB(KNIGHT, squares[i+3], 0) : 0);
+        else {
+            __m256i gen = _mm256_setr_epi64x(BB(squares[i+0]),
+                                             i+1 < count ? BB(squares[i+1]) : 0,
+                                             i+2 < count ? BB(squares[i+2]) : 0,
+                                             i+3 < count ? BB(squares[i+3]) : 0);
+            attacks = _mm256_setzero_si256();
+
+            if (pt == ROOK || pt == QUEEN)
+                attacks = _mm256_or_si256(attacks, FillX4(gen, ~occ,  8, ~0ULL)),
+                attacks = _mm256_or_si256(attacks, FillX4(gen, ~occ, -8, ~0ULL)),
+                attacks = _mm256_or_si256(attacks, FillX4(gen, ~occ,  1, notA)),
+                attacks = _mm256_or_si256(attacks, FillX4(gen, ~occ, -1, notH));
+
+            if (pt == BISHOP || pt == QUEEN)
+                attacks = _mm256_or_si256(attacks, FillX4(gen, ~occ,  9, notA)),
+                attacks = _mm256_or_si256(attacks, FillX4(gen, ~occ,  7, notH)),
+                attacks = _mm256_or_si256(attacks, FillX4(gen, ~occ, -7, notA)),
+                attacks = _mm256_or_si256(attacks, FillX4(gen, ~occ, -9, notH));
+        }
+
+        __m256i mobility = _mm256_and_si256(attacks, _mm256_set1_epi64x(mobilityArea));
+
+        _mm256_storeu_si256((__m256i *)&pai->attacks[i], attacks);
+        _mm256_storeu_si256((__m256i *)&pai->mobility[i], PopCountX4(mobility));
+        _mm256_storeu_si256((__m256i *)&pai->kingAttacks[i],
+                            PopCountX4(_mm256_and_si256(mobility, _mm256_set1_epi64x(kingZone))));
+        _mm256_storeu_si256((__m256i *)&pai->checks[i],
+                            PopCountX4(_mm256_and_si256(mobility, _mm256_set1_epi64x(checkSquares))));
+    }
+
+#else
+
+    for (int i = 0; i < count; ++i) {
+        Bitboard attacks  = XRayAttackBB(pos, color, pt, squares[i]);
+        Bitboard mobility = attacks & mobilityArea;
+        pai->attacks[i]     = attacks;
+        pai->mobility[i]    = PopCount(mobility);
+        pai->kingAttacks[i] = PopCount(mobility & kingZone);
+        pai->checks[i]      = PopCount(mobility & checkSquares);
+    }
+
+#endif
+}
+
 // Evaluates knights, bishops, rooks, or queens
+template <bool Trace>
 INLINE int EvalPiece(const Position *pos, EvalInfo *ei, const Color color, const PieceType pt) {
 
-    const Direction up   = color == WHITE ? NORTH : SOUTH;
     const Direction down = color == WHITE ? SOUTH : NORTH;
 
     int eval = 0;
@@ -258,24 +418,32 @@ INLINE int EvalPiece(const Position *pos, EvalInfo *ei, const Color color, const
 
     ei->attackedBy[color][pt] = 0;
 
+    // Attacks of all the pieces at once
+    Square squares[MAX_PIECES];
+    int pieceCount = 0;
+    while (pieces)
+        squares[pieceCount++] = PopLsb(&pieces);
+
+    PieceAttackInfo pai;
+    PieceAttacks(pos, ei, color, pt, squares, pieceCount, &pai);
+
     // Evaluate each individual piece
-    while (pieces) {
+    for (int i = 0; i < pieceCount; ++i) {
 
-        Square sq = PopLsb(&pieces);
+        Square sq = squares[i];
 
         TraceIncr(PieceValue[pt-1]);
         TraceIncr(PSQT[pt-1][BlackRelativeSquare(color, sq)]);
 
         // Mobility
-        Bitboard attackBB = XRayAttackBB(pos, color, pt, sq);
-        Bitboard mobilityBB = attackBB & ei->mobilityArea[color];
-        int mob = PopCount(mobilityBB);
+        Bitboard attackBB = pai.attacks[i];
+        int mob = pai.mobility[i];
         eval += Mobility[pt-2][mob];
         TraceIncr(Mobility[pt-2][mob]);
 
         // Attacks for king safety calculations
-        int attacks = PopCount(mobilityBB & ei->kingZone[!color]);
-        int checks  = PopCount(mobilityBB & AttackBB(pt, kingSq(!color), pieceBB(ALL)));
+        int attacks = pai.kingAttacks[i];
+        int checks  = pai.checks[i];
 
         if (attacks > 0 || checks > 0) {
             ei->attackCount[color]++;
@@ -300,11 +468,10 @@ INLINE int EvalPiece(const Position *pos, EvalInfo *ei, const Color color, const
 
         // Forward mobility for rooks
         if (pt == ROOK) {
-            Bitboard forward = Fill(BB(sq), up);
-            if (!(forward & pieceBB(PAWN))) {
+            if (!(BB(sq) & ei->pawns.pawnsAhead[color])) {
                 eval += OpenForward;
                 TraceIncr(OpenForward);
-            } else if (!(forward & colorPieceBB(color, PAWN))) {
+            } else if (!(BB(sq) & ei->pawns.ownPawnsAhead[color])) {
                 eval += SemiForward;
                 TraceIncr(SemiForward);
             }
@@ -315,6 +482,7 @@ INLINE int EvalPiece(const Position *pos, EvalInfo *ei, const Color color, const
 }
 
 // Evaluates kings
+template <bool Trace>
 INLINE int EvalKings(const Position *pos, EvalInfo *ei, const Color color) {
 
     int eval = 0;
@@ -344,7 +512,7 @@ INLINE int EvalKings(const Position *pos, EvalInfo *ei, const Color color) {
 
     // Pawn shelter
     Bitboard pawnsInFront = pieceBB(PAWN) & PassedMask[color][kingSq];
-    Bitboard ourPawns = pawnsInFront & colorBB(color) & ~PawnBBAttackBB(colorPieceBB(!color, PAWN), !color);
+    Bitboard ourPawns = pawnsInFront & colorBB(color) & ~ei->pawns.pawnAttacks[!color];
 
     count = PopCount(ourPawns);
     eval += count * Shelter;
@@ -354,20 +522,22 @@ INLINE int EvalKings(const Position *pos, EvalInfo *ei, const Color color) {
 }
 
 // Evaluates all non-pawns
+template <bool Trace>
 INLINE int EvalPieces(const Position *pos, EvalInfo *ei) {
-    return  EvalPiece(pos, ei, WHITE, KNIGHT)
-          - EvalPiece(pos, ei, BLACK, KNIGHT)
-          + EvalPiece(pos, ei, WHITE, BISHOP)
-          - EvalPiece(pos, ei, BLACK, BISHOP)
-          + EvalPiece(pos, ei, WHITE, ROOK)
-          - EvalPiece(pos, ei, BLACK, ROOK)
-          + EvalPiece(pos, ei, WHITE, QUEEN)
-          - EvalPiece(pos, ei, BLACK, QUEEN)
-          + EvalKings(pos, ei, WHITE)
-          - EvalKings(pos, ei, BLACK);
+    return  EvalPiece<Trace>(pos, ei, WHITE, KNIGHT)
+          - EvalPiece<Trace>(pos, ei, BLACK, KNIGHT)
+          + EvalPiece<Trace>(pos, ei, WHITE, BISHOP)
+          - EvalPiece<Trace>(pos, ei, BLACK, BISHOP)
+          + EvalPiece<Trace>(pos, ei, WHITE, ROOK)
+          - EvalPiece<Trace>(pos, ei, BLACK, ROOK)
+          + EvalPiece<Trace>(pos, ei, WHITE, QUEEN)
+          - EvalPiece<Trace>(pos, ei, BLACK, QUEEN)
+          + EvalKings<Trace>(pos, ei, WHITE)
+          - EvalKings<Trace>(pos, ei, BLACK);
 }
 
 // Evaluates passed pawns
+template <bool Trace>
 INLINE int EvalPassedPawns(const Position *pos, const EvalInfo *ei, const Color color) {
 
     const Direction up   = color == WHITE ? NORTH : SOUTH;
@@ -426,6 +596,7 @@ INLINE int EvalPassedPawns(const Position *pos, const EvalInfo *ei, const Color
 }
 
 // Evaluates threats
+template <bool Trace>
 INLINE int EvalThreats(const Position *pos, const EvalInfo *ei, const Color color) {
 
     const Direction up = color == WHITE ? NORTH : SOUTH;
@@ -437,7 +608,7 @@ INLINE int EvalThreats(const Position *pos, const EvalInfo *ei, const Color colo
     Bitboard ourPawns = colorPieceBB(color, PAWN);
     Bitboard theirNonPawns = colorBB(!color) ^ colorPieceBB(!color, PAWN);
 
-    count = PopCount(PawnBBAttackBB(ourPawns, color) & theirNonPawns);
+    count = PopCount(ei->pawns.pawnAttacks[color] & theirNonPawns);
     eval += PawnThreat * count;
     TraceCount(PawnThreat);
 
@@ -479,7 +650,7 @@ INLINE void InitEvalInfo(const Position *pos, EvalInfo *ei, const Color color) {
     // Mobility area is defined as any square not attacked by an enemy pawn, nor
     // occupied by our own pawn either on its starting square or blocked from advancing.
     b = pawns & (RankBB[RelativeRank(color, RANK_2)] | ShiftBB(pieceBB(ALL), down));
-    ei->mobilityArea[color] = ~(b | PawnBBAttackBB(colorPieceBB(!color, PAWN), !color));
+    ei->mobilityArea[color] = ~(b | ei->pawns.pawnAttacks[!color]);
 
     // King Safety
     ei->kingZone[color] = AttackBB(KING, kingSq(color), 0);
@@ -487,81 +658,147 @@ INLINE void InitEvalInfo(const Position *pos, EvalInfo *ei, const Color color) {
     ei->attackPower[color] = -30;
     ei->attackCount[color] = 0;
 
-    // Clear passed pawns, filled in during pawn eval
-    ei->passedPawns = 0;
-
     ei->attackedBy[color][KING] = AttackBB(KING, kingSq(color), 0);
-    ei->attackedBy[color][PAWN] = PawnBBAttackBB(pawns, color);
+    ei->attackedBy[color][PAWN] = ei->pawns.pawnAttacks[color];
     ei->attackedBy[color][ALL] = ei->attackedBy[color][KING] | ei->attackedBy[color][PAWN];
 }
 
-// Calculate scale factor to lower overall eval based on various features
-static int ScaleFactor(const Position *pos, const int eval) {
+// Computes the material dependent parts of the eval
+static void InitMaterialEntry(const Position *pos, MaterialEntry *me) {
+
+    me->key = pos->materialKey;
+
+    Endgame *eg = &EndgameTable[EndgameIndex(pos->materialKey)];
+    me->evalFunc = eg->key == pos->materialKey ? eg->evalFunc : NULL;
+
+    // No imbalance terms yet
+    me->imbalance = 0;
 
     // Scale down eval the fewer pawns the stronger side has
+    for (Color color = WHITE; color <= BLACK; ++color) {
+        int x = 8 - PopCount(colorPieceBB(color, PAWN));
+        me->pawnScale[color] = 128 - x * x;
+    }
+
+    // Scale applied if the single bishops turn out to be of opposite colors
+    me->ocbScale =   pos->nonPawnCount[WHITE] <= 2
+                  && pos->nonPawnCount[BLACK] <= 2
+                  && pos->nonPawnCount[WHITE] == pos->nonPawnCount[BLACK]
+                  && Single(colorPieceBB(WHITE, BISHOP))
+                  && Single(colorPieceBB(BLACK, BISHOP))
+                ? (pos->nonPawnCount[WHITE] == 1 ? 64 : 96) : 0;
+}
+
+// Tries to get the material entry from cache, otherwise computes and saves
+static const MaterialEntry *ProbeMaterialCache(const Position *pos, MaterialEntry *local, MaterialCache mc) {
+
+    MaterialEntry *me = mc ? &mc[pos->materialKey % MATERIAL_CACHE_SIZE] : local;
+
+    if (!mc || me->key != pos->materialKey)
+        InitMaterialEntry(pos, me);
+
+    return me;
+}
+
+// Calculate scale factor to lower overall eval based on various features
+static int ScaleFactor(const Position *pos, const MaterialEntry *me, const int eval) {
+
     Color strong = eval > 0 ? WHITE : BLACK;
     Bitboard strongPawns = colorPieceBB(strong, PAWN);
 
-    int strongPawnCount = PopCount(strongPawns);
-    int x = 8 - strongPawnCount;
-    int pawnScale = 128 - x * x;
+    int pawnScale = me->pawnScale[strong];
 
     // Scale down when there aren't pawns on both sides of the board
     if (!(strongPawns & QueenSideBB) || !(strongPawns & KingSideBB))
         pawnScale -= 20;
 
     // Opposite-colored bishop
-    if (   pos->nonPawnCount[WHITE] <= 2
-        && pos->nonPawnCount[BLACK] <= 2
-        && pos->nonPawnCount[WHITE] == pos->nonPawnCount[BLACK]
-        && Single(colorPieceBB(WHITE, BISHOP))
-        && Single(colorPieceBB(BLACK, BISHOP))
-        && Single(pieceBB(BISHOP) & BlackSquaresBB))
-        return MIN((pos->nonPawnCount[WHITE] == 1 ? 64 : 96), pawnScale);
+    if (me->ocbScale && Single(pieceBB(BISHOP) & BlackSquaresBB))
+        return MIN(me->ocbScale, pawnScale);
 
     return pawnScale;
 }
 
-// Calculate a static evaluation of a position
-int EvalPosition(const Position *pos, PawnCache pc) {
+// Applies the scale factor and phase, and returns the result from the side to move's point of view
+template <bool Trace>
+INLINE int FinalizeEval(const Position *pos, const MaterialEntry *me, int eval) {
 
-    Endgame *eg = &EndgameTable[EndgameIndex(pos->materialKey)];
+    // Adjust eval by scale factor
+    int scale = ScaleFactor(pos, me, eval);
+    TraceScale(scale);
+
+    // Adjust score by phase
+    eval = (  MgScore(eval) * pos->phase
+            + EgScore(eval) * (MidGame - pos->phase) * scale / 128)
+          / MidGame;
 
-    if (eg->key == pos->materialKey && eg->evalFunc != NULL)
-        return eg->evalFunc(pos, sideToMove);
+    // Return the evaluation, negated if we are black + tempo bonus
+    return (sideToMove == WHITE ? eval : -eval) + Tempo;
+}
+
+// Calculate a static evaluation of a position, stopping after the cheap terms
+// if they are enough to put the eval LAZY_MARGIN above lazyThreshold
+template <bool Trace>
+INLINE int Evaluate(const Position *pos, PawnCache *pc, MaterialCache mc, int lazyThreshold, bool *lazy) {
+
+    MaterialEntry local;
+    const MaterialEntry *me = ProbeMaterialCache(pos, &local, mc);
+
+    if (me->evalFunc != NULL)
+        return me->evalFunc(pos, sideToMove);
+
+    // The trace is of the hand-crafted terms
+    if (!Trace && NNUEActive)
+        return NNUEEvaluate(pos);
 
     EvalInfo ei;
-    InitEvalInfo(pos, &ei, WHITE);
-    InitEvalInfo(pos, &ei, BLACK);
 
-    // Material (includes PSQT) + trend
-    int eval = pos->material + pos->trend;
+    // Material (includes PSQT) + imbalance + trend
+    int eval = pos->material + me->imbalance + pos->trend;
 
     // Evaluate pawns
-    eval += ProbePawnCache(pos, &ei, pc);
+    eval += ProbePawnCache<Trace>(pos, &ei, pc);
+
+    InitEvalInfo(pos, &ei, WHITE);
+    InitEvalInfo(pos, &ei, BLACK);
+
+    // Lazy exit
+    if (lazyThreshold != NOSCORE) {
+        int partial = FinalizeEval<Trace>(pos, me, eval);
+        if (partial - LAZY_MARGIN >= lazyThreshold)
+            return *lazy = true, partial;
+    }
 
     // Evaluate pieces
-    eval += EvalPieces(pos, &ei);
+    eval += EvalPieces<Trace>(pos, &ei);
 
     // Evaluate passed pawns
-    eval +=  EvalPassedPawns(pos, &ei, WHITE)
-           - EvalPassedPawns(pos, &ei, BLACK);
+    eval +=  EvalPassedPawns<Trace>(pos, &ei, WHITE)
+           - EvalPassedPawns<Trace>(pos, &ei, BLACK);
 
     // Evaluate threats
-    eval +=  EvalThreats(pos, &ei, WHITE)
-           - EvalThreats(pos, &ei, BLACK);
+    eval +=  EvalThreats<Trace>(pos, &ei, WHITE)
+           - EvalThreats<Trace>(pos, &ei, BLACK);
 
     TraceEval(eval);
 
-    // Adjust eval by scale factor
-    int scale = ScaleFactor(pos, eval);
-    TraceScale(scale);
+    return FinalizeEval<Trace>(pos, me, eval);
+}
 
-    // Adjust score by phase
-    eval = (  MgScore(eval) * pos->phase
-            + EgScore(eval) * (MidGame - pos->phase) * scale / 128)
-          / MidGame;
+int EvalPosition(const Position *pos, PawnCache *pc, MaterialCache mc) {
+    bool lazy;
+    return Evaluate<false>(pos, pc, mc, NOSCORE, &lazy);
+}
 
-    // Return the evaluation, negated if we are black + tempo bonus
-    return (sideToMove == WHITE ? eval : -eval) + Tempo;
+int EvalPositionLazy(const Position *pos, PawnCache *pc, MaterialCache mc, int lazyThreshold, bool *lazy) {
+    *lazy = false;
+    return Evaluate<false>(pos, pc, mc, lazyThreshold, lazy);
+}
+
+int EvalPositionTrace(const Position *pos, EvalTrace *trace) {
+    bool lazy;
+    T = EvalTrace();
+    int eval = Evaluate<true>(pos, NULL, NULL, NOSCORE, &lazy);
+    *trace = T;
+    return eval;
 }
@@ -19,18 +19,99 @@
 #pragma once
 
 #include "board.h"
+#include "endgame.h"
 #include "types.h"
 
 
-#define PAWN_CACHE_SIZE 128 * 1024
+#define PAWN_HASH_DEFAULT 4
+#define PAWN_HASH_MIN 1
+#define PAWN_HASH_MAX 256
 
+// Everything about a position that only depends on the pawns, one cache line.
+// The check is the upper half of the pawn key xored with the rest of the entry,
+// so torn writes to a cache shared between threads are detected on probe
 typedef struct PawnEntry {
-    Key key;
+    uint32_t check;
+    int32_t eval;
     Bitboard passedPawns;
-    int eval;
+    Bitboard pawnAttacks[COLOR_NB];
+    Bitboard pawnsAhead[COLOR_NB];
+    Bitboard ownPawnsAhead[COLOR_NB];
 } PawnEntry;
 
-typedef PawnEntry PawnCache[PAWN_CACHE_SIZE];
+static_assert(sizeof(PawnEntry) == 64, "PawnEntry should fill a cache line");
+
+typedef struct PawnCache {
+    PawnEntry *table;
+    uint64_t mask;
+} PawnCache;
+
+#define EVAL_CACHE_SIZE (64 * 1024)
+
+// The eval includes the trend set at the root, so an entry is only
+// good for the trend it was computed with
+typedef struct EvalEntry {
+    Key key;
+    int eval;
+    int trend;
+} EvalEntry;
+
+typedef EvalEntry EvalCache[EVAL_CACHE_SIZE];
+
+#define MATERIAL_CACHE_SIZE (8 * 1024)
+
+// Everything about a position that only depends on the material
+typedef struct MaterialEntry {
+    Key key;
+    SpecializedEval evalFunc;
+    int imbalance;
+    int pawnScale[COLOR_NB];
+    int ocbScale;
+} MaterialEntry;
+
+typedef MaterialEntry MaterialCache[MATERIAL_CACHE_SIZE];
+
+
+// Counts of each eval term per color, used to find the coefficients for tuning
+typedef struct EvalTrace {
+
+    int eval;
+    int scale;
+    int danger[COLOR_NB];
+
+    int PieceValue[5][COLOR_NB];
+    int PSQT[6][64][COLOR_NB];
+
+    int PawnDoubled[COLOR_NB];
+    int PawnDoubled2[COLOR_NB];
+    int PawnIsolated[COLOR_NB];
+    int PawnSupport[COLOR_NB];
+    int PawnThreat[COLOR_NB];
+    int PushThreat[COLOR_NB];
+    int PawnOpen[COLOR_NB];
+    int BishopPair[COLOR_NB];
+    int KingAtkPawn[COLOR_NB];
+    int OpenForward[COLOR_NB];
+    int SemiForward[COLOR_NB];
+    int NBBehindPawn[COLOR_NB];
+    int BishopBadP[COLOR_NB];
+    int Shelter[COLOR_NB];
+
+    int PawnPassed[RANK_NB][COLOR_NB];
+    int PassedDefended[RANK_NB][COLOR_NB];
+    int PassedBlocked[RANK_NB][COLOR_NB];
+    int PassedFreeAdv[RANK_NB][COLOR_NB];
+    int PassedDistUs[RANK_NB][COLOR_NB];
+    int PassedDistThem[COLOR_NB];
+    int PassedRookBack[COLOR_NB];
+    int PassedSquare[COLOR_NB];
+    int PawnPhalanx[RANK_NB][COLOR_NB];
+    int ThreatByMinor[8][COLOR_NB];
+    int ThreatByRook[8][COLOR_NB];
+    int KingLineDanger[28][COLOR_NB];
+    int Mobility[4][28][COLOR_NB];
+
+} EvalTrace;
 
 
 extern const int Tempo;
@@ -54,11 +135,20 @@ INLINE int UpdatePhase(int value) {
 }
 
 // Returns a static evaluation of the position from the side to move's point of view
-int EvalPosition(const Position *pos, PawnCache pc);
+int EvalPosition(const Position *pos, PawnCache *pc, MaterialCache mc);
+
+// Margin above which piece, passed pawn and threat terms can't pull the eval back
+#define LAZY_MARGIN 500
+
+// Same, but may settle for a partial eval that is at least LAZY_MARGIN above lazyThreshold
+int EvalPositionLazy(const Position *pos, PawnCache *pc, MaterialCache mc, int lazyThreshold, bool *lazy);
+
+// Same as EvalPosition, but always hand-crafted and uncached, filling in the trace
+int EvalPositionTrace(const Position *pos, EvalTrace *trace);
 
 // Returns a static evaluation of the position from whites point of view
-INLINE int EvalPositionWhitePov(const Position *pos, PawnCache pc) {
-    int score = EvalPosition(pos, pc);
+INLINE int EvalPositionWhitePov(const Position *pos, PawnCache *pc, MaterialCache mc) {
+    int score = EvalPosition(pos, pc, mc);
     return sideToMove == WHITE ? score : -score;
 }
 
@@ -16,6 +16,8 @@
   along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include <string.h>
+
 #include "bitboard.h"
 #include "board.h"
 #include "evaluate.h"
@@ -63,6 +65,8 @@ static void ClearPiece(Position *pos, const Square sq, const bool hash) {
 
     // Update material
     pos->material -= PSQT[piece][sq];
+    if (NNUEActive)
+        NNUERemovePiece(&pos->acc, piece, sq);
 
     // Update phase
     pos->phaseValue -= PhaseValue[pt];
@@ -110,6 +114,8 @@ static void AddPiece(Position *pos, const Square sq, const Piece piece, const bo
 
     // Update material
     pos->material += PSQT[piece][sq];
+    if (NNUEActive)
+        NNUEAddPiece(&pos->acc, piece, sq);
 
     // Update phase
     pos->phaseValue += PhaseValue[pt];
@@ -159,6 +165,8 @@ static void MovePiece(Position *pos, const Square from, const Square to, const b
 
     // Update material
     pos->material += PSQT[piece][to] - PSQT[piece][from];
+    if (NNUEActive)
+        NNUEMovePiece(&pos->acc, piece, from, to);
 
     // Update bitboards
     pieceBB(ALL)   ^= BB(from) ^ BB(to);
@@ -166,6 +174,57 @@ static void MovePiece(Position *pos, const Square from, const Square to, const b
     colorBB(color) ^= BB(from) ^ BB(to);
 }
 
+#ifdef COPY_MAKE
+// Save the state of the position before making a move
+INLINE void SaveState(Position *pos) {
+    memcpy(&history(0).state, pos, sizeof(PositionState));
+}
+
+// The accumulator is too large to copy every ply, so the changes the move
+// made to it are undone (the board is already back to how it was before it)
+static void UndoAccumulator(Position *pos, const Move move) {
+
+    const Square from = fromSq(move);
+    const Square to = toSq(move);
+    const Piece piece = pieceOn(from);
+
+    if (moveIsCastle(move)) {
+        const Color color = ColorOf(piece);
+        const int side = FileOf(to) == FILE_G ? OO : OOO;
+        const Square rookFrom = RookSquare[side & (color == WHITE ? WHITE_CASTLE : BLACK_CASTLE)];
+        const Square rookTo = RelativeSquare(color, side == OO ? F1 : D1);
+        NNUERemovePiece(&pos->acc, piece, to);
+        NNUEAddPiece(&pos->acc, piece, from);
+        NNUEMovePiece(&pos->acc, MakePiece(color, ROOK), rookTo, rookFrom);
+        return;
+    }
+
+    if (promotion(move))
+        NNUERemovePiece(&pos->acc, promotion(move), to),
+        NNUEAddPiece(&pos->acc, piece, from);
+    else
+        NNUEMovePiece(&pos->acc, piece, to, from);
+
+    if (moveIsEnPas(move))
+        NNUEAddPiece(&pos->acc, MakePiece(!ColorOf(piece), PAWN), to ^ 8);
+    else if (capturing(move))
+        NNUEAddPiece(&pos->acc, capturing(move), to);
+}
+#endif
+
+#ifdef COPY_MAKE
+// Take back the previous move by putting back the state from before it
+void TakeMove(Position *pos) {
+
+    pos->histPly--;
+    memcpy(pos, &history(0).state, sizeof(PositionState));
+
+    if (NNUEActive)
+        UndoAccumulator(pos, history(0).move);
+
+    assert(PositionOk(pos));
+}
+#else
 // Take back the previous move
 void TakeMove(Position *pos) {
 
@@ -221,26 +280,73 @@ done:
     pos->key            = history(0).key;
     pos->materialKey    = history(0).materialKey;
     pos->checkers       = history(0).checkers;
+    pos->pinned         = history(0).pinned;
     pos->epSquare       = history(0).epSquare;
     pos->rule50         = history(0).rule50;
     pos->castlingRights = history(0).castlingRights;
 
     assert(PositionOk(pos));
 }
+#endif
+
+// Finds where each piece type would check the enemy king from, and which pieces
+// can uncover a check. Kept in the history entry of the position, so it is done
+// once however many moves are made from it
+static void SetCheckInfo(Position *pos) {
+
+    History *info = &history(0);
+    const Square kingSq = kingSq(!sideToMove);
+
+    info->checkKey = pos->key;
+    info->checkSquares[PAWN]   = PawnAttackBB(!sideToMove, kingSq);
+    info->checkSquares[KNIGHT] = AttackBB(KNIGHT, kingSq, pieceBB(ALL));
+    info->checkSquares[BISHOP] = AttackBB(BISHOP, kingSq, pieceBB(ALL));
+    info->checkSquares[ROOK]   = AttackBB(ROOK,   kingSq, pieceBB(ALL));
+    info->checkSquares[QUEEN]  = info->checkSquares[BISHOP] | info->checkSquares[ROOK];
+    info->checkSquares[KING]   = 0;
+    info->discoverers = Discoverers(pos);
+}
+
+// False when a move can't give check. Castling, en passant and promotions
+// are left to the full test after the move
+INLINE bool MayGiveCheck(const Position *pos, const Move move) {
+
+    if (move & (FLAG_CASTLE | FLAG_ENPAS | MOVE_PROMO))
+        return true;
+
+    const Square from = fromSq(move);
+    const Square to = toSq(move);
+
+    return (history(0).checkSquares[PieceTypeOf(piece(move))] & BB(to))
+        || (   (history(0).discoverers & BB(from))
+            && !(LineBB[from][to] & colorPieceBB(!sideToMove, KING)));
+}
 
 // Make a move - take it back and return false if move was illegal
 void MakeMove(Position *pos, const Move move) {
 
     TTPrefetch(KeyAfter(pos, move));
 
+    assert(pos->histPly < pos->historySize);
+
+    if (history(0).checkKey != pos->key)
+        SetCheckInfo(pos);
+
+    const bool mayCheck = MayGiveCheck(pos, move);
+
     // Save position
     history(0).key            = pos->key;
+    history(0).move           = move;
+#ifdef COPY_MAKE
+    SaveState(pos);
+#else
     history(0).materialKey    = pos->materialKey;
     history(0).checkers       = pos->checkers;
-    history(0).move           = move;
+    history(0).pinned         = pos->pinned;
     history(0).epSquare       = pos->epSquare;
     history(0).rule50         = pos->rule50;
     history(0).castlingRights = pos->castlingRights;
+#endif
 
     // Incremental updates
     pos->histPly++;
@@ -316,7 +422,9 @@ done:
     sideToMove ^= 1;
     HASH_SIDE;
 
-    pos->checkers = Checkers(pos);
+    pos->checkers = mayCheck ? Checkers(pos) : 0;
+    assert(pos->checkers == Checkers(pos));
+    pos->pinned = Pinned(pos);
     pos->nodes++;
 
     assert(PositionOk(pos));
@@ -325,12 +433,19 @@ done:
 // Pass the turn without moving
 void MakeNullMove(Position *pos) {
 
+    assert(pos->histPly < pos->historySize);
+
     // Save misc info for takeback
     history(0).key            = pos->key;
     history(0).move           = NOMOVE;
+#ifdef COPY_MAKE
+    SaveState(pos);
+#else
+    history(0).pinned         = pos->pinned;
     history(0).epSquare       = pos->epSquare;
     history(0).rule50         = pos->rule50;
     history(0).castlingRights = pos->castlingRights;
+#endif
 
     // Incremental updates
     pos->histPly++;
@@ -342,11 +457,21 @@ void MakeNullMove(Position *pos) {
     HASH_EP;
     pos->epSquare = 0;
 
+    pos->pinned = Pinned(pos);
+
     TTPrefetch(pos->key);
 
     assert(PositionOk(pos));
 }
 
+#ifdef COPY_MAKE
+// Take back a null move
+void TakeNullMove(Position *pos) {
+    pos->histPly--;
+    memcpy(pos, &history(0).state, sizeof(PositionState));
+    assert(PositionOk(pos));
+}
+#else
 // Take back a null move
 void TakeNullMove(Position *pos) {
 
@@ -356,8 +481,10 @@ void TakeNullMove(Position *pos) {
 
     // Get info from history
     pos->key      = history(0).key;
+    pos->pinned   = history(0).pinned;
     pos->epSquare = history(0).epSquare;
     pos->rule50   = history(0).rule50;
 
     assert(PositionOk(pos));
 }
+#endif
@@ -0,0 +1,362 @@
+/*
+  Weiss is a UCI compliant chess engine.
+  Copyright (C) 2023 Terje Kirstihagen
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "makemove.h"
+#include "mate.h"
+#include "move.h"
+#include "movegen.h"
+#include "search.h"
+#include "threads.h"
+#include "time.h"
+#include "uci.h"
+
+
+// Depth-first proof-number search (df-pn) for 'go mate'. The attacker may
+// only play checks while the defender tries every legal move, and a node's
+// depth is the number of plies left for the attacker to deliver mate.
+// All threads search the same root and cooperate through a shared table.
+
+#define PN_INFINITE 100000000u
+#define MATE_HASH_SIZE (1 << 20)
+#define MATE_LOCKS 1024
+#define MATE_MOVES 256
+
+typedef struct MateEntry {
+    uint32_t key;
+    uint32_t pn, dn;
+    int32_t depth;
+} MateEntry;
+
+typedef struct MateNode {
+    Move move;
+    Key key;
+    bool draw;
+} MateNode;
+
+
+bool MateSolver = true;
+
+static MateEntry *MateTable;
+static std::atomic_bool MateLocks[MATE_LOCKS];
+static std::atomic_bool MateStop;
+static std::atomic_int MateLength;
+
+
+INLINE void Lock(uint64_t idx) {
+    while (MateLocks[idx % MATE_LOCKS].exchange(true, std::memory_order_acquire));
+}
+
+INLINE void Unlock(uint64_t idx) {
+    MateLocks[idx % MATE_LOCKS].store(false, std::memory_order_release);
+}
+
+// Proof and disproof numbers of a position, (1, 1) if unknown
+static void Lookup(Key key, int depth, uint32_t *pn, uint32_t *dn) {
+
+    uint64_t idx = key % MATE_HASH_SIZE;
+
+    Lock(idx);
+    MateEntry entry = MateTable[idx];
+    Unlock(idx);
+
+    *pn = *dn = 1;
+
+    if (entry.key != (uint32_t)(key >> 32) || (!entry.pn && !entry.dn))
+        return;
+
+    // A mate proven with fewer plies holds with more, and vice versa
+    if (   (entry.pn == 0 && entry.depth <= depth)
+        || (entry.dn == 0 && entry.depth >= depth)
+        ||  entry.depth == depth)
+        *pn = entry.pn, *dn = entry.dn;
+}
+
+static void Store(Key key, int depth, uint32_t pn, uint32_t dn) {
+
+    uint64_t idx = key % MATE_HASH_SIZE;
+
+    Lock(idx);
+    MateTable[idx] = { (uint32_t)(key >> 32), pn, dn, depth };
+    Unlock(idx);
+}
+
+// The attacker's checks or the defender's evasions
+static int GenNodes(Position *pos, bool attacker, bool root, MateNode *nodes) {
+
+    MoveList list;
+    list.count = list.next = 0;
+    GenLegalMoves(pos, &list);
+
+    int count = 0;
+
+    for (int i = 0; i < list.count; ++i) {
+
+        Move move = list.moves[i].move;
+
+        if (root && NotInSearchMoves(Limits.searchmoves, move)) continue;
+
+        MakeMove(pos, move);
+        if (!attacker || pos->checkers)
+            nodes[count++] = { move, pos->key, IsRepetition(pos) };
+        TakeMove(pos);
+    }
+
+    return count;
+}
+
+static bool Stopped(Thread *thread) {
+
+    // Half the time is left for the normal search to fall back on
+    if (   thread->index == 0
+        && (   OutOfTime(thread)
+            || (Limits.timelimit && TimeSince(Limits.start) >= Limits.optimalUsage / 2)))
+        MateStop = true;
+
+    // Every thread stops once one of them has proven a mate
+    return loadRelaxed(MateStop) || loadRelaxed(MateLength) || loadRelaxed(ABORT_SIGNAL);
+}
+
+INLINE uint32_t SatAdd(uint32_t a, uint32_t b) {
+    return MIN(PN_INFINITE, a + b);
+}
+
+// Expands a node until its proof or disproof number reaches its threshold, and
+// passes the numbers back. A disproof that relies on a repetition of the current
+// path would be wrong for the same position reached another way, so it is not
+// stored, and true is returned for the parent to keep it itself
+static bool MID(Thread *thread, uint32_t thpn, uint32_t thdn, int depth, bool attacker, int ply,
+                uint32_t *nodePn, uint32_t *nodeDn) {
+
+    Position *pos = &thread->pos;
+    MateNode nodes[MATE_MOVES];
+    uint32_t pns[MATE_MOVES], dns[MATE_MOVES];
+    bool kept[MATE_MOVES];
+    uint32_t pn = PN_INFINITE, dn = 0;
+
+    *nodePn = *nodeDn = 1;
+
+    if (Stopped(thread)) return false;
+
+    // The attacker has run out of plies
+    if (attacker && depth <= 0) {
+        Store(pos->key, depth, *nodePn = PN_INFINITE, *nodeDn = 0);
+        return false;
+    }
+
+    int count = GenNodes(pos, attacker, ply == 0, nodes);
+
+    // No checks left for the attacker, or the defender is mated
+    if (!count || (!attacker && depth <= 0)) {
+        if (!attacker && !count) pn = 0, dn = PN_INFINITE;
+        Store(pos->key, depth, *nodePn = pn, *nodeDn = dn);
+        return false;
+    }
+
+    for (int i = 0; i < count; ++i)
+        kept[i] = false;
+
+    bool dependent;
+
+    // Helpers break ties differently to spread out over the tree
+    int offset = (thread->index * 7 + ply) % count;
+
+    while (true) {
+
+        pn = attacker ? PN_INFINITE : 0;
+        dn = attacker ? 0 : PN_INFINITE;
+
+        int best = 0;
+        uint32_t second = PN_INFINITE;
+        bool anyDependent = false, ownDisproof = false;
+
+        for (int j = 0; j < count; ++j) {
+
+            int i = (j + offset) % count;
+
+            // Repetitions are draws, so no mate
+            if (nodes[i].draw)
+                pns[i] = PN_INFINITE, dns[i] = 0;
+            else if (!kept[i])
+                Lookup(nodes[i].key, depth - 1, &pns[i], &dns[i]);
+
+            // The attacker is disproven only if all children are, the
+            // defender by any one child that doesn't rely on the path
+            bool childDependent = nodes[i].draw || kept[i];
+            anyDependent |= childDependent;
+            ownDisproof |= dns[i] == 0 && !childDependent;
+
+            // The attacker needs one child proven, the defender one disproven
+            uint32_t *mins = attacker ? pns : dns;
+            uint32_t  curr = attacker ? pn : dn;
+
+            if (mins[i] < curr)
+                second = curr, best = i;
+            else if (mins[i] < second)
+                second = mins[i];
+
+            if (attacker)
+                pn = MIN(pn, pns[i]), dn = SatAdd(dn, dns[i]);
+            else
+                dn = MIN(dn, dns[i]), pn = SatAdd(pn, pns[i]);
+        }
+
+        dependent = attacker ? anyDependent : !ownDisproof;
+
+        if (pn >= thpn || dn >= thdn) break;
+
+        uint32_t childThpn = attacker ? MIN(thpn, second + 1) : thpn - pn + pns[best];
+        uint32_t childThdn = attacker ? thdn - dn + dns[best] : MIN(thdn, second + 1);
+
+        MakeMove(pos, nodes[best].move);
+        kept[best] = MID(thread, childThpn, childThdn, depth - 1, !attacker, ply + 1, &pns[best], &dns[best]);
+        TakeMove(pos);
+
+        if (Stopped(thread)) return false;
+    }
+
+    *nodePn = pn, *nodeDn = dn;
+
+    if (dn == 0 && dependent)
+        return true;
+
+    Store(pos->key, depth, pn, dn);
+    return false;
+}
+
+// The fewest plies a position is known to be mated in, -1 if unproven
+static int ProvenIn(const MateNode *node, int depth) {
+    for (int d = 0; d < depth && !node->draw; ++d) {
+        uint32_t pn, dn;
+        Lookup(node->key, d, &pn, &dn);
+        if (pn == 0) return d;
+    }
+    return -1;
+}
+
+// Follows proven moves from the root to build the mating line
+static void ExtractPV(Position *pos, int depth, PV *pv) {
+
+    MateNode nodes[MATE_MOVES];
+
+    pv->length = 0;
+
+    for (bool attacker = true; depth > 0; attacker = !attacker, --depth) {
+
+        int count = GenNodes(pos, attacker, pv->length == 0, nodes);
+        int best = -1, bestPlies = attacker ? depth : -1;
+
+        // The attacker takes the quickest mate, the defender the slowest
+        for (int i = 0; i < count; ++i) {
+            int plies = ProvenIn(&nodes[i], depth);
+            if (plies == -1) continue;
+            if (attacker ? plies < bestPlies : plies > bestPlies)
+                best = i, bestPlies = plies;
+        }
+
+        if (best == -1) break;
+
+        pv->line[pv->length++] = PackMove(nodes[best].move);
+        MakeMove(pos, nodes[best].move);
+    }
+
+    for (int i = 0; i < pv->length; ++i)
+        TakeMove(pos);
+}
+
+// Looks for mates of increasing length until one is proven
+static void *MateThread(void *voidThread) {
+
+    Thread *thread = (Thread*)voidThread;
+    Position *pos = &thread->pos;
+
+    if (thread->index != 0)
+        PrepareThread(thread);
+
+    // Long mates go deeper than the history reserved for the search
+    ReserveHistory(pos, pos->histPly + 2 * abs(Limits.mate) + 1);
+
+    for (int moves = 1; moves <= abs(Limits.mate); ++moves) {
+
+        uint32_t pn, dn;
+        int depth = 2 * moves - 1;
+
+        thread->depth = depth;
+        MID(thread, PN_INFINITE, PN_INFINITE, depth, true, 0, &pn, &dn);
+
+        if (Stopped(thread)) break;
+
+        if (pn == 0) {
+            int none = 0;
+            MateLength.compare_exchange_strong(none, moves);
+            break;
+        }
+    }
+
+    if (thread->index == 0)
+        MateStop = true;
+
+    return NULL;
+}
+
+// Tries to prove a mate for 'go mate', returns false if the normal search should run
+bool SolveMate() {
+
+    if (!MateTable)
+        MateTable = (MateEntry *)malloc(MATE_HASH_SIZE * sizeof(MateEntry));
+
+    memset(MateTable, 0, MATE_HASH_SIZE * sizeof(MateEntry));
+    MateStop = false;
+    MateLength = 0;
+
+    StartHelpers(MateThread);
+    MateThread(&Threads[0]);
+    WaitForHelpers();
+
+    // Fall back to the normal search, which also finds mates without checks.
+    // Out of time it has the half of the time the solver left it
+    if (!MateLength) {
+        PrepareThread(&Threads[0]);
+        return false;
+    }
+
+    Thread *thread = &Threads[0];
+    PV pv;
+
+    thread->depth = 2 * MateLength - 1;
+    ExtractPV(&thread->pos, thread->depth, &pv);
+
+    if (pv.length == 0) return false;
+
+    // Move the mating move to the front
+    for (int i = 1; i < thread->rootMoveCount; ++i)
+        if (PackMove(thread->rootMoves[i].move) == pv.line[0]) {
+            RootMove tmp = thread->rootMoves[0];
+            thread->rootMoves[0] = thread->rootMoves[i];
+            thread->rootMoves[i] = tmp;
+        }
+
+    thread->rootMoves[0].pv = pv;
+    thread->rootMoves[0].score = mateIn(thread->depth);
+
+    PrintThinking(thread, -INFINITE, INFINITE);
+
+    return true;
+}
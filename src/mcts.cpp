@@ -0,0 +1,326 @@
+/*
+  Weiss is a UCI compliant chess engine.
+  Copyright (C) 2023 Terje Kirstihagen
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "board.h"
+#include "makemove.h"
+#include "mcts.h"
+#include "move.h"
+#include "movegen.h"
+#include "search.h"
+#include "threads.h"
+#include "time.h"
+#include "uci.h"
+
+
+// Monte Carlo tree search with PUCT selection. All threads grow one shared
+// tree from the root, using virtual losses to spread out, and value new
+// leaves with a short alpha-beta search. Node values are stored from the
+// view of the side that made the move leading to the node.
+
+#define TREE_SIZE (1 << 21)
+#define TREE_DEPTH 64
+#define LEAF_DEPTH 2
+#define VALUE_SCALE 1000000
+#define CPUCT 1.5
+#define FPU_REDUCTION 0.2
+
+enum { UNEXPANDED, EXPANDING, EXPANDED };
+
+typedef struct Node {
+    std::atomic<int64_t> valueSum;
+    std::atomic<int> visits;
+    std::atomic<int> state;
+    int firstChild;
+    int childCount;
+    Move move;
+    float prior;
+} Node;
+
+
+bool MCTSMode = false;
+
+static Node *Tree;
+static std::atomic<int> TreeUsed;
+static std::atomic<int> TreeDepth;
+
+
+// Win probability from a centipawn score, and the other way around
+static double ScoreToValue(int score) {
+    return isMate(score) ? (score > 0 ? 1.0 : -1.0)
+                         : 2.0 / (1.0 + exp(-score / 200.0)) - 1.0;
+}
+
+static int ValueToScore(double value) {
+    value = CLAMP(value, -0.999, 0.999);
+    return -200.0 * log(2.0 / (value + 1.0) - 1.0);
+}
+
+static void InitNode(Node *node, Move move, float prior) {
+    node->valueSum = 0;
+    node->visits = 0;
+    node->state = UNEXPANDED;
+    node->firstChild = node->childCount = 0;
+    node->move = move;
+    node->prior = prior;
+}
+
+// Rough prior for a move, favouring good captures and promotions
+static float Prior(const Position *pos, Move move) {
+    return moveIsNoisy(move) ? (SEE(pos, move, 0) ? 4.0 : 0.5) : 1.0;
+}
+
+// Adds the children of a node, unless the tree is full
+static void Expand(Thread *thread, Node *node, bool root) {
+
+    Position *pos = &thread->pos;
+    MoveList list;
+    list.count = list.next = 0;
+
+    // The root moves already respect searchmoves
+    if (root)
+        for (int i = 0; i < thread->rootMoveCount; ++i)
+            list.moves[list.count++].move = thread->rootMoves[i].move;
+    else
+        GenLegalMoves(pos, &list);
+
+    // Give the room back and leave the node to be expanded again if it doesn't fit
+    int first = TreeUsed.fetch_add(list.count);
+    if (first + list.count > TREE_SIZE) {
+        TreeUsed.fetch_sub(list.count);
+        node->state.store(UNEXPANDED, std::memory_order_relaxed);
+        return;
+    }
+
+    float total = 0;
+    for (int i = 0; i < list.count; ++i)
+        total += Prior(pos, list.moves[i].move);
+
+    for (int i = 0; i < list.count; ++i)
+        InitNode(&Tree[first + i], list.moves[i].move, Prior(pos, list.moves[i].move) / total);
+
+    node->firstChild = first;
+    node->childCount = list.count;
+    node->state.store(EXPANDED, std::memory_order_release);
+}
+
+// Picks the child with the highest PUCT score
+static Node *SelectChild(Node *node) {
+
+    int parentVisits = node->visits.load(std::memory_order_relaxed);
+    double sqrtVisits = sqrt(MAX(1, parentVisits));
+    double parentValue = parentVisits ? -(double)node->valueSum / VALUE_SCALE / parentVisits : 0;
+    double fpu = parentValue - FPU_REDUCTION;
+
+    Node *best = &Tree[node->firstChild];
+    double bestScore = -1e9;
+
+    for (Node *child = &Tree[node->firstChild]; child < &Tree[node->firstChild + node->childCount]; ++child) {
+
+        int visits = child->visits.load(std::memory_order_relaxed);
+        double q = visits ? (double)child->valueSum / VALUE_SCALE / visits : fpu;
+        double u = CPUCT * child->prior * sqrtVisits / (1 + visits);
+
+        if (q + u > bestScore)
+            bestScore = q + u, best = child;
+    }
+
+    return best;
+}
+
+// Walks down the tree, values a new leaf, and updates the nodes on the path
+static void Playout(Thread *thread) {
+
+    Position *pos = &thread->pos;
+    Node *path[TREE_DEPTH + 1];
+    int length = 0;
+    double value;
+
+    Node *node = &Tree[0];
+    node->visits++;
+    path[length++] = node;
+
+    while (true) {
+
+        // The tree root is at ply 0, like the root of a normal search
+        Stack *ss = thread->ss + SS_OFFSET + length - 1;
+
+        // Draws by repetition or the 50 move rule
+        if (length > 1 && (IsRepetition(pos) || pos->rule50 >= 100)) {
+            value = 0;
+            break;
+        }
+
+        int state = node->state.load(std::memory_order_acquire);
+
+        // Expand new nodes and value them with a short search. Nodes another
+        // thread is expanding, or that did not fit in the tree, are just valued
+        if (state != EXPANDED || length > TREE_DEPTH) {
+            if (   state == UNEXPANDED
+                && length <= TREE_DEPTH
+                && node->state.exchange(EXPANDING) == UNEXPANDED)
+                Expand(thread, node, length == 1);
+
+            value = ScoreToValue(LeafSearch(thread, ss, LEAF_DEPTH));
+            break;
+        }
+
+        // Checkmate or stalemate
+        if (!node->childCount) {
+            value = pos->checkers ? -1.0 : 0.0;
+            break;
+        }
+
+        // Step into the best child with a virtual loss
+        node = SelectChild(node);
+        node->visits++;
+        node->valueSum -= VALUE_SCALE;
+        path[length++] = node;
+
+        Move move = node->move;
+        ss->move = move;
+        ss->continuation = &thread->continuation[!!pos->checkers][moveIsCapture(move)][piece(move)][toSq(move)];
+        ss->contCorr = &thread->contCorrHistory[piece(move)][toSq(move)];
+        MakeMove(pos, move);
+    }
+
+    if (length - 1 > TreeDepth)
+        TreeDepth = length - 1;
+
+    // Back up the value, replacing the virtual losses
+    for (int i = length - 1; i >= 0; --i) {
+        value = -value;
+        path[i]->valueSum += (int64_t)(value * VALUE_SCALE) + (i ? VALUE_SCALE : 0);
+        if (i) TakeMove(pos);
+    }
+}
+
+// Sets the most visited root move first, with its line and score
+static void UpdateRootMoves(Thread *thread) {
+
+    Node *root = &Tree[0];
+    if (root->state != EXPANDED || !root->childCount) return;
+
+    Node *best = NULL;
+    PV pv;
+    pv.length = 0;
+
+    for (Node *node = root; node->state == EXPANDED && node->childCount && pv.length < MAX_PLY; ) {
+
+        Node *next = &Tree[node->firstChild];
+        for (Node *child = next; child < &Tree[node->firstChild + node->childCount]; ++child)
+            if (child->visits > next->visits)
+                next = child;
+
+        if (!next->visits) break;
+
+        if (!best) best = next;
+        pv.line[pv.length++] = PackMove(next->move);
+        node = next;
+    }
+
+    if (!best) return;
+
+    for (int i = 1; i < thread->rootMoveCount; ++i)
+        if (thread->rootMoves[i].move == best->move) {
+            RootMove tmp = thread->rootMoves[0];
+            thread->rootMoves[0] = thread->rootMoves[i];
+            thread->rootMoves[i] = tmp;
+        }
+
+    thread->rootMoves[0].pv = pv;
+    thread->rootMoves[0].score = ValueToScore((double)best->valueSum / VALUE_SCALE / MAX(1, best->visits.load()));
+    thread->depth = MAX(2, TreeDepth.load());
+}
+
+// The main thread decides when to stop, helpers run until told to
+static bool Stop(Thread *thread) {
+
+    if (loadRelaxed(ABORT_SIGNAL) || !thread->rootMoveCount)
+        return true;
+
+    if (thread->index != 0)
+        return false;
+
+    return (Limits.timelimit && TimeSince(Limits.start) >= Limits.optimalUsage)
+        || (Limits.nodeTime && TotalNodes() >= Limits.nodes)
+        || (Limits.mate && isMate(thread->rootMoves[0].score)
+                        && MATE - abs(thread->rootMoves[0].score) <= 2 * abs(Limits.mate))
+        ||  TreeDepth >= Limits.depth;
+}
+
+static void *MCTSThread(void *voidThread) {
+
+    Thread *thread = (Thread*)voidThread;
+    bool mainThread = thread->index == 0;
+    TimePoint lastInfo = Now();
+
+    if (!mainThread)
+        PrepareThread(thread);
+
+    thread->depth = LEAF_DEPTH;
+    thread->doPruning = true;
+
+    // Jump here and return when the leaf searches run out of time
+    if (setjmp(thread->jumpBuffer)) return NULL;
+
+    for (uint64_t playouts = 1; !Stop(thread); ++playouts) {
+
+        Playout(thread);
+
+        if (!mainThread || playouts % 64) continue;
+
+        UpdateRootMoves(thread);
+
+        if (!Minimal && TimeSince(lastInfo) >= 1000) {
+            PrintThinking(thread, -INFINITE, INFINITE);
+            lastInfo = Now();
+        }
+
+        thread->depth = LEAF_DEPTH;
+    }
+
+    return NULL;
+}
+
+// Searches the root position with all threads sharing one tree
+void SearchMCTS() {
+
+    if (!Tree)
+        Tree = (Node *)malloc(TREE_SIZE * sizeof(Node));
+
+    InitNode(&Tree[0], NOMOVE, 1.0);
+    TreeUsed = 1;
+    TreeDepth = 0;
+
+    StartHelpers(MCTSThread);
+    FirstNodeLatency = NowMicro() - Limits.startMicro;
+    MCTSThread(&Threads[0]);
+
+    // The main thread may have stopped mid-playout, the root moves are still valid
+    UpdateRootMoves(&Threads[0]);
+    PrintThinking(&Threads[0], -INFINITE, INFINITE);
+}
+
+// Releases the tree when leaving MCTS mode, the next MCTS search allocates it again
+void FreeMCTSTree() {
+    free(Tree);
+    Tree = NULL;
+}
@@ -75,6 +75,18 @@ bool MoveIsPseudoLegal(const Position *pos, const Move move) {
 // (assumes the move is pseudo-legal in the current position)
 bool MoveIsLegal(const Position *pos, const Move move) {
 
+    const Square from = fromSq(move);
+
+    // Out of check, only king moves, en passant and pinned pieces can expose the king
+    if (!pos->checkers && pieceTypeOn(from) != KING && !moveIsEnPas(move))
+        return !(pos->pinned & BB(from)) || (LineBB[from][toSq(move)] & colorPieceBB(sideToMove, KING));
+
+    return KingSafeAfter(pos, move);
+}
+
+// Checks that the king is not attacked after the move, the general but slower legality test
+bool KingSafeAfter(const Position *pos, const Move move) {
+
     Color color = sideToMove;
     Square from = fromSq(move);
     Square to = toSq(move);
@@ -102,19 +114,72 @@ bool MoveIsLegal(const Position *pos, const Move move) {
     return !(kingAttackers & ~exclude);
 }
 
+// Rebuilds a move from its packed form, returns NOMOVE when the packed
+// move can't be pseudo-legal in the position (e.g. after a TT key collision)
+Move UnpackMove(const Position *pos, const PackedMove packed) {
+
+    const Color color = sideToMove;
+    const Square from = packedFrom(packed);
+    const Square to   = packedTo(packed);
+    const Piece piece = pieceOn(from);
+    const Piece capt  = pieceOn(to);
+    const int special = packed & PACKED_SPECIAL;
+
+    // Must move our own piece
+    if (!packed || piece == EMPTY || ColorOf(piece) != color)
+        return NOMOVE;
+
+    // Castling, rights and path are checked by MoveIsPseudoLegal
+    if (special == PACKED_CASTLE)
+        return   PieceTypeOf(piece) == KING
+              && RelativeRank(color, RankOf(to)) == RANK_1
+              && (FileOf(to) == FILE_C || FileOf(to) == FILE_G)
+            ? MOVE(from, to, piece, capt, EMPTY, FLAG_CASTLE) : NOMOVE;
+
+    if (capt != EMPTY && ColorOf(capt) == color)
+        return NOMOVE;
+
+    if (PieceTypeOf(piece) != PAWN)
+        return special ? NOMOVE : MOVE(from, to, piece, capt, EMPTY, FLAG_NONE);
+
+    // Pawn moves need their shape verified as MoveIsPseudoLegal trusts the flags
+    const bool promo = RelativeRank(color, RankOf(to)) == RANK_8;
+    const Direction up = color == WHITE ? NORTH : SOUTH;
+
+    if ((special == PACKED_PROMO) != promo)
+        return NOMOVE;
+
+    if (special == PACKED_ENPAS)
+        return to == pos->epSquare && (PawnAttackBB(color, from) & BB(to))
+            ? MOVE(from, to, piece, EMPTY, EMPTY, FLAG_ENPAS) : NOMOVE;
+
+    if (capt != EMPTY ? PawnAttackBB(color, from) & BB(to) : to == from + up)
+        return MOVE(from, to, piece, capt, promo ? MakePiece(color, packedPromo(packed)) : EMPTY, FLAG_NONE);
+
+    if (capt == EMPTY && to == from + 2 * up && RelativeRank(color, RankOf(from)) == RANK_2)
+        return MOVE(from, to, piece, EMPTY, EMPTY, FLAG_PAWNSTART);
+
+    return NOMOVE;
+}
+
 // Translates a move to a string
 char *MoveToStr(const Move move) {
+    return PackedMoveToStr(PackMove(move));
+}
+
+// Translates a packed move to a string
+char *PackedMoveToStr(const PackedMove packed) {
 
     static char moveStr[6] = "";
 
-    SqToStr(fromSq(move), moveStr);
-    SqToStr(  toSq(move), moveStr + 2);
-    moveStr[4] = "\0.nbrq"[PieceTypeOf(promotion(move))];
+    SqToStr(packedFrom(packed), moveStr);
+    SqToStr(  packedTo(packed), moveStr + 2);
+    moveStr[4] = (packed & PACKED_SPECIAL) == PACKED_PROMO ? ".pnbrq"[packedPromo(packed)] : '\0';
 
     // Encode castling as KxR for chess 960
-    if (Chess960 && moveIsCastle(move)) {
-        int color = ColorOf(piece(move)) == WHITE ? WHITE_CASTLE : BLACK_CASTLE;
-        int side = FileOf(toSq(move)) == FILE_G ? OO : OOO;
+    if (Chess960 && (packed & PACKED_SPECIAL) == PACKED_CASTLE) {
+        int color = RankOf(packedTo(packed)) == RANK_1 ? WHITE_CASTLE : BLACK_CASTLE;
+        int side = FileOf(packedTo(packed)) == FILE_G ? OO : OOO;
         SqToStr(RookSquare[color & side], moveStr + 2);
     }
 
@@ -67,6 +67,30 @@
 #define moveIsNoisy(move)   ((bool)(move & (MOVE_CAPT | MOVE_PROMO | FLAG_ENPAS)))
 #define moveIsQuiet(move)   ((bool)(!moveIsNoisy(move)))
 
+/* Packed move - 16 bits, the rest is recovered from the board
+0000 0000 0011 1111 -> From       <<  0
+0000 1111 1100 0000 -> To         <<  6
+0011 0000 0000 0000 -> Promotion  << 12 (piece type - KNIGHT)
+1100 0000 0000 0000 -> Special    << 14 (promotion, en passant, castle)
+*/
+
+#define PACKED_SPECIAL  0xC000
+#define PACKED_PROMO    0x4000
+#define PACKED_ENPAS    0x8000
+#define PACKED_CASTLE   0xC000
+
+#define packedFrom(packed)  ((packed) & 0x3F)
+#define packedTo(packed)   (((packed) >> 6) & 0x3F)
+#define packedPromo(packed) (KNIGHT + (((packed) >> 12) & 3))
+
+INLINE PackedMove PackMove(const Move move) {
+    return fromSq(move) | toSq(move) << 6
+         | (promotion(move)    ? PACKED_PROMO | (PieceTypeOf(promotion(move)) - KNIGHT) << 12
+          : moveIsEnPas(move)  ? PACKED_ENPAS
+          : moveIsCastle(move) ? PACKED_CASTLE
+                               : 0);
+}
+
 
 // Checks legality of a specific castle move given the current position
 INLINE bool CastleLegal(const Position *pos, Square to) {
@@ -93,6 +117,9 @@ INLINE bool CastleLegal(const Position *pos, Square to) {
 
 bool MoveIsPseudoLegal(const Position *pos, Move move);
 bool MoveIsLegal(const Position *pos, const Move move);
+bool KingSafeAfter(const Position *pos, const Move move);
+Move UnpackMove(const Position *pos, PackedMove packed);
 char *MoveToStr(Move move);
+char *PackedMoveToStr(PackedMove packed);
 Move ParseMove(const char *ptrChar, const Position *pos);
 bool NotInSearchMoves(Move searchmoves[], Move move);
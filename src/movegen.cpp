@@ -16,6 +16,10 @@
   along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
+#if defined(__AVX2__) && defined(SIMD_MOVEGEN)
+#include <immintrin.h>
+#endif
+
 #include "bitboard.h"
 #include "makemove.h"
 #include "move.h"
@@ -29,12 +33,87 @@ INLINE void AddMove(const Position *pos, MoveList *list, const Square from, cons
     list->moves[list->count++].move = MOVE(from, to, pieceOn(from), pieceOn(to), promo, flag);
 }
 
+#if defined(__AVX2__) && defined(SIMD_MOVEGEN)
+// The set bits of every byte value, to serialize a bitboard 8 squares at a time
+static uint8_t ByteBits[256][8];
+
+CONSTR(1, InitByteBits) {
+    for (int byte = 0; byte < 256; ++byte)
+        for (int bit = 0, count = 0; bit < 8; ++bit)
+            if (byte & (1 << bit))
+                ByteBits[byte][count++] = bit;
+}
+#endif
+
+// Adds a move to each target square from either a single square, or for pawns
+// from dir behind each target. The AVX2 version builds and stores the moves of
+// a byte of the target bitboard together, writing up to 7 entries past the end
+// of the list into MOVELIST_SLACK. Opt-in with -DSIMD_MOVEGEN
+// as targets are too sparse for it to beat the PopLsb loop (see movegenbench)
+INLINE void AddMoves(const Position *pos, MoveList *list, const Piece piece, const Square from, const Direction dir, Bitboard targets, const int flag) {
+
+#if defined(__AVX2__) && defined(SIMD_MOVEGEN)
+    const __m256i fixed = _mm256_set1_epi32(from | piece << 12 | flag);
+    const __m256i iota  = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    // One pass for each byte of the bitboard that has targets in it
+    while (targets) {
+
+        const int offset = Lsb(targets) & ~7;
+        const int byte = (targets >> offset) & 0xFF;
+        targets &= ~(0xFFull << offset);
+
+        const __m256i squares = _mm256_add_epi32(iota, _mm256_set1_epi32(offset));
+
+        // Build the moves to all 8 squares of the byte, then pack the targets to the front
+        __m256i capt = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)&pos->board[offset]));
+        __m256i move = _mm256_or_si256(fixed, _mm256_or_si256(_mm256_slli_epi32(squares, 6), _mm256_slli_epi32(capt, 16)));
+
+        if (dir)
+            move = _mm256_or_si256(move, _mm256_sub_epi32(squares, _mm256_set1_epi32(dir)));
+
+        move = _mm256_permutevar8x32_epi32(move, _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)ByteBits[byte])));
+
+        // Spread the moves 3 ints apart with the rest zeroed, the layout of MoveListEntry
+        static_assert(sizeof(MoveListEntry) == 12, "AVX2 stores assume 12 byte move list entries");
+        static_assert(MOVELIST_SLACK >= 7, "AVX2 stores write up to 7 entries past the last move");
+        const __m256i zero = _mm256_setzero_si256();
+        __m256i *out = (__m256i *)&list->moves[list->count];
+        _mm256_storeu_si256(out,     _mm256_blend_epi32(zero, _mm256_permutevar8x32_epi32(move, _mm256_setr_epi32(0, 0, 0, 1, 0, 0, 2, 0)), 0x49));
+        _mm256_storeu_si256(out + 1, _mm256_blend_epi32(zero, _mm256_permutevar8x32_epi32(move, _mm256_setr_epi32(0, 3, 0, 0, 4, 0, 0, 5)), 0x92));
+        _mm256_storeu_si256(out + 2, _mm256_blend_epi32(zero, _mm256_permutevar8x32_epi32(move, _mm256_setr_epi32(0, 0, 6, 0, 0, 7, 0, 0)), 0x24));
+
+        list->count += PopCount(byte);
+    }
+#else
+    while (targets) {
+        Square to = PopLsb(&targets);
+        list->moves[list->count++].move = MOVE(dir ? to - dir : from, to, piece, pieceOn(to), EMPTY, flag);
+    }
+#endif
+}
+
+// Adds a king move, castling or en passant, the moves that can expose the king
+// in ways the pin and check masks don't cover, if it leaves the king safe
+INLINE void AddIfKingSafe(const Position *pos, MoveList *list, const Square from, const Square to, const int flag) {
+    Move move = MOVE(from, to, pieceOn(from), pieceOn(to), EMPTY, flag);
+    if (KingSafeAfter(pos, move))
+        list->moves[list->count++].move = move;
+}
+
+// Pinned pieces can only move along the line through their king
+INLINE bool PinAllows(const Position *pos, const Square from, const Square to) {
+    return !(pos->pinned & BB(from)) || (LineBB[from][to] & colorPieceBB(sideToMove, KING));
+}
+
 // Adds promotions
 INLINE void AddPromotions(const Position *pos, MoveList *list, const Color color, const int type, Bitboard moves, const Direction dir) {
     while (moves) {
         Square to = PopLsb(&moves);
         Square from = to - dir;
 
+        if (!PinAllows(pos, from, to)) continue;
+
         if (type == NOISY)
             AddMove(pos, list, from, to, MakePiece(color, QUEEN), FLAG_NONE);
 
@@ -47,10 +126,16 @@ INLINE void AddPromotions(const Position *pos, MoveList *list, const Color color
 }
 
 // Adds pawn moves aside from promos and en passant
-INLINE void AddPawnMoves(const Position *pos, MoveList *list, Bitboard moves, const Direction dir, const int flag) {
+INLINE void AddPawnMoves(const Position *pos, MoveList *list, const Color color, Bitboard moves, const Direction dir, const int flag) {
+
+    // With pinned pawns involved every move is checked, keeping the usual order
+    if (!(moves & ShiftBB(pos->pinned, dir)))
+        return AddMoves(pos, list, MakePiece(color, PAWN), 0, dir, moves, flag);
+
     while (moves) {
         Square to = PopLsb(&moves);
-        AddMove(pos, list, to - dir, to, EMPTY, flag);
+        if (PinAllows(pos, to - dir, to))
+            AddMove(pos, list, to - dir, to, EMPTY, flag);
     }
 }
 
@@ -64,12 +149,12 @@ INLINE void GenCastling(const Position *pos, MoveList *list, const Color color,
     // King side castle
     Square toShort = RelativeSquare(color, G1);
     if (CastleLegal(pos, toShort))
-        AddMove(pos, list, from, toShort, EMPTY, FLAG_CASTLE);
+        AddIfKingSafe(pos, list, from, toShort, FLAG_CASTLE);
 
     // Queen side castle
     Square toLong = RelativeSquare(color, C1);
     if (CastleLegal(pos, toLong))
-        AddMove(pos, list, from, toLong, EMPTY, FLAG_CASTLE);
+        AddIfKingSafe(pos, list, from, toLong, FLAG_CASTLE);
 }
 
 // Pawns are a mess
@@ -99,8 +184,8 @@ INLINE void GenPawn(const Position *pos, MoveList *list, const Color color, cons
             moves   &= BetweenBB[kingSq(color)][Lsb(pos->checkers)],
             doubles &= BetweenBB[kingSq(color)][Lsb(pos->checkers)];
 
-        AddPawnMoves(pos, list, moves, up, FLAG_NONE);
-        AddPawnMoves(pos, list, doubles, up * 2, FLAG_PAWNSTART);
+        AddPawnMoves(pos, list, color, moves, up, FLAG_NONE);
+        AddPawnMoves(pos, list, color, doubles, up * 2, FLAG_PAWNSTART);
     }
 
     // Promotions
@@ -113,8 +198,8 @@ INLINE void GenPawn(const Position *pos, MoveList *list, const Color color, cons
     // Captures
     if (type == NOISY) {
 
-        AddPawnMoves(pos, list, lCap & normal, up+left,  FLAG_NONE);
-        AddPawnMoves(pos, list, rCap & normal, up+right, FLAG_NONE);
+        AddPawnMoves(pos, list, color, lCap & normal, up+left,  FLAG_NONE);
+        AddPawnMoves(pos, list, color, rCap & normal, up+right, FLAG_NONE);
 
         // En passant
         if (pos->epSquare) {
@@ -122,7 +207,7 @@ INLINE void GenPawn(const Position *pos, MoveList *list, const Color color, cons
                 return;
             Bitboard enPassers = pawns & PawnAttackBB(!color, pos->epSquare);
             while (enPassers)
-                AddMove(pos, list, PopLsb(&enPassers), pos->epSquare, EMPTY, FLAG_ENPAS);
+                AddIfKingSafe(pos, list, PopLsb(&enPassers), pos->epSquare, FLAG_ENPAS);
         }
     }
 }
@@ -141,12 +226,22 @@ INLINE void GenPieceType(const Position *pos, MoveList *list, const Color color,
     while (pieces) {
         Square from = PopLsb(&pieces);
         Bitboard moves = targets & AttackBB(pt, from, occupied);
-        while (moves)
-            AddMove(pos, list, from, PopLsb(&moves), EMPTY, FLAG_NONE);
+
+        if (pt == KING) {
+            while (moves)
+                AddIfKingSafe(pos, list, from, PopLsb(&moves), FLAG_NONE);
+            continue;
+        }
+
+        if (pos->pinned & BB(from))
+            moves &= LineBB[kingSq(color)][from];
+
+        AddMoves(pos, list, MakePiece(color, pt), from, 0, moves, FLAG_NONE);
     }
 }
 
-// Generate all quiet or noisy moves for the given color
+// Generate all legal quiet or noisy moves for the given color, using the pinned
+// pieces and the check mask so only king moves and en passant need a full test
 static void GenMoves(const Position *pos, MoveList *list, const Color color, const int type) {
 
     if (Multiple(pos->checkers))
@@ -174,16 +269,9 @@ void GenAllMoves(const Position *pos, MoveList *list) {
     GenQuietMoves(pos, list);
 }
 
+// Generated moves are always legal, this is kept for the callers that need them all
 void GenLegalMoves(const Position *pos, MoveList *list) {
-    MoveList allMoves;
-    allMoves.count = allMoves.next = 0;
-    GenAllMoves(pos, &allMoves);
-
-    for (int i = 0; i < allMoves.count; ++i) {
-        Move move = allMoves.moves[i].move;
-        if (!MoveIsLegal(pos, move)) continue;
-        list->moves[list->count++].move = move;
-    }
+    GenAllMoves(pos, list);
 }
 
 int LegalMoveCount(const Position *pos) {
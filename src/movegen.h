@@ -22,15 +22,22 @@
 #include "types.h"
 
 
+#define SEE_UNKNOWN INT16_MIN
+
+// The AVX2 AddMoves stores 8 entries at a time, up to 7 of them past the last
+// move, so the list keeps that much room beyond the 256 moves it can hold
+#define MOVELIST_SLACK 8
+
 typedef struct {
     Move move;
     int score;
+    int16_t see;
 } MoveListEntry;
 
 typedef struct {
     int count;
     int next;
-    MoveListEntry moves[256];
+    MoveListEntry moves[256 + MOVELIST_SLACK];
 } MoveList;
 
 
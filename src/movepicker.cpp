@@ -30,13 +30,13 @@ static Move PickNextMove(MovePicker *mp) {
     if (list->next == list->count)
         return NOMOVE;
 
-    Move bestMove = list->moves[list->next++].move;
+    mp->current = &list->moves[list->next++];
 
     // Avoid returning the TT or killer moves again
-    if (bestMove == mp->ttMove || bestMove == mp->killer)
+    if (mp->current->move == mp->ttMove || mp->current->move == mp->killer)
         return PickNextMove(mp);
 
-    return bestMove;
+    return mp->current->move;
 }
 
 // Partial insertion sort
@@ -67,6 +67,7 @@ static void ScoreMoves(MovePicker *mp, const int stage) {
         list->moves[i].score =
             stage == GEN_QUIET ? GetQuietHistory(thread, mp->ss, move)
                                : GetCaptureHistory(thread, move) + PieceValue[MG][capturing(move)];
+        list->moves[i].see = SEE_UNKNOWN;
     }
 
     SortMoves(list, -750 * mp->depth);
@@ -84,7 +85,9 @@ Move NextMove(MovePicker *mp) {
 
         case TTMOVE:
             mp->stage++;
-            return mp->ttMove;
+            mp->current = NULL;
+            if (MoveIsLegal(pos, mp->ttMove))
+                return mp->ttMove;
 
             // fall through
         case GEN_NOISY:
@@ -96,19 +99,21 @@ Move NextMove(MovePicker *mp) {
         case NOISY_GOOD:
             // Save seemingly bad noisy moves for later
             while ((move = PickNextMove(mp)))
-                if (    mp->list.moves[mp->list.next-1].score >  11046
-                    || (mp->list.moves[mp->list.next-1].score > - 9543 && SEE(pos, move, mp->threshold)))
+                if (    mp->current->score >  11046
+                    || (mp->current->score > - 9543 && MoveSEE(mp, move, mp->threshold)))
                     return move;
                 else
-                    mp->list.moves[mp->bads++].move = move;
+                    mp->list.moves[mp->bads++] = *mp->current;
 
             mp->stage++;
 
             // fall through
         case KILLER:
             mp->stage++;
+            mp->current = NULL;
             if (   mp->killer != mp->ttMove
-                && MoveIsPseudoLegal(pos, mp->killer))
+                && MoveIsPseudoLegal(pos, mp->killer)
+                && MoveIsLegal(pos, mp->killer))
                 return mp->killer;
 
             // fall through
@@ -131,7 +136,8 @@ Move NextMove(MovePicker *mp) {
 
             // fall through
         case NOISY_BAD:
-            return mp->list.moves[mp->list.next++].move;
+            mp->current = &mp->list.moves[mp->list.next++];
+            return mp->current->move;
 
         default:
             assert(0);
@@ -139,9 +145,35 @@ Move NextMove(MovePicker *mp) {
     }
 }
 
+// Static Exchange Evaluation of the move NextMove last returned, the exchange
+// value is kept in its list entry so later thresholds are only a comparison
+bool MoveSEE(MovePicker *mp, const Move move, const int threshold) {
+
+    Thread *thread = mp->thread;
+    const Position *pos = &thread->pos;
+
+    if (moveIsSpecial(move))
+        return true;
+
+    StatIncr(seeTests);
+
+    // The TT move and killer aren't in the list
+    if (!mp->current)
+        return StatIncr(seeValues), SEE(pos, move, threshold);
+
+    assert(mp->current->move == move);
+
+    if (mp->current->see == SEE_UNKNOWN)
+        StatIncr(seeValues),
+        mp->current->see = SEEValue(pos, move);
+
+    return mp->current->see >= threshold;
+}
+
 // Init normal movepicker
 void InitNormalMP(MovePicker *mp, Thread *thread, Stack *ss, Depth depth, Move ttMove, Move killer) {
     mp->list.count = mp->list.next = 0;
+    mp->current   = NULL;
     mp->thread    = thread;
     mp->ss        = ss;
     mp->ttMove    = ttMove;
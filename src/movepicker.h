@@ -30,6 +30,7 @@ typedef struct MovePicker {
     Thread *thread;
     Stack *ss;
     MoveList list;
+    MoveListEntry *current;
     MPStage stage;
     Depth depth;
     Move ttMove, killer;
@@ -40,6 +41,7 @@ typedef struct MovePicker {
 
 
 Move NextMove(MovePicker *mp);
+bool MoveSEE(MovePicker *mp, Move move, int threshold);
 void InitNormalMP(MovePicker *mp, Thread *thread, Stack *ss, Depth depth, Move ttMove, Move killer);
 void InitNoisyMP(MovePicker *mp, Thread *thread, Stack *ss, Move ttMove);
 void InitProbcutMP(MovePicker *mp, Thread *thread, Stack *ss, int threshold);
@@ -0,0 +1,271 @@
+/*
+  Weiss is a UCI compliant chess engine.
+  Copyright (C) 2023 Terje Kirstihagen
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+#include "bitboard.h"
+#include "board.h"
+#include "nnue.h"
+
+
+typedef struct Network {
+    int16_t featureWeights[NNUE_INPUTS][NNUE_HIDDEN];
+    int16_t featureBias[NNUE_HIDDEN];
+    int16_t outputWeights[COLOR_NB][NNUE_HIDDEN];
+    int16_t outputBias;
+} Network;
+
+#define NET_SIZE (sizeof(NetHeader) + offsetof(Network, outputBias) + sizeof(int16_t))
+
+bool UseNNUE = true;
+bool NNUEActive = false;
+
+static const Network *Net;
+static void *mapping;
+static size_t mappedSize;
+#ifdef _WIN32
+static HANDLE mapHandle;
+#endif
+
+
+// SIMD kernels, falling back to plain loops the compiler may still vectorize
+#if defined(__AVX2__)
+typedef __m256i Vec;
+#define VEC_SIZE 16
+#define VecLoad(p)      _mm256_loadu_si256((const Vec *)(p))
+#define VecStore(p, v)  _mm256_storeu_si256((Vec *)(p), v)
+#define VecAdd16        _mm256_add_epi16
+#define VecSub16        _mm256_sub_epi16
+#define VecClamp(v)     _mm256_min_epi16(_mm256_max_epi16(v, _mm256_setzero_si256()), _mm256_set1_epi16(NNUE_QA))
+#define VecMadd         _mm256_madd_epi16
+#define VecAdd32        _mm256_add_epi32
+#define VecZero         _mm256_setzero_si256
+INLINE int VecSum32(Vec v) {
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+    return _mm_cvtsi128_si32(s);
+}
+#elif defined(__SSE4_1__)
+typedef __m128i Vec;
+#define VEC_SIZE 8
+#define VecLoad(p)      _mm_loadu_si128((const Vec *)(p))
+#define VecStore(p, v)  _mm_storeu_si128((Vec *)(p), v)
+#define VecAdd16        _mm_add_epi16
+#define VecSub16        _mm_sub_epi16
+#define VecClamp(v)     _mm_min_epi16(_mm_max_epi16(v, _mm_setzero_si128()), _mm_set1_epi16(NNUE_QA))
+#define VecMadd         _mm_madd_epi16
+#define VecAdd32        _mm_add_epi32
+#define VecZero         _mm_setzero_si128
+INLINE int VecSum32(Vec v) {
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, 0x4E));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, 0xB1));
+    return _mm_cvtsi128_si32(v);
+}
+#endif
+
+// Adds and subtracts feature weights from an accumulator perspective
+INLINE void AddSub(int16_t *acc, const int16_t *add, const int16_t *sub) {
+#ifdef VEC_SIZE
+    for (int i = 0; i < NNUE_HIDDEN; i += VEC_SIZE) {
+        Vec v = VecLoad(&acc[i]);
+        if (add) v = VecAdd16(v, VecLoad(&add[i]));
+        if (sub) v = VecSub16(v, VecLoad(&sub[i]));
+        VecStore(&acc[i], v);
+    }
+#else
+    for (int i = 0; i < NNUE_HIDDEN; ++i)
+        acc[i] += (add ? add[i] : 0) - (sub ? sub[i] : 0);
+#endif
+}
+
+// Clipped ReLU of the accumulator dotted with the output weights
+INLINE int Output(const int16_t *acc, const int16_t *weights) {
+#ifdef VEC_SIZE
+    Vec sum = VecZero();
+    for (int i = 0; i < NNUE_HIDDEN; i += VEC_SIZE)
+        sum = VecAdd32(sum, VecMadd(VecClamp(VecLoad(&acc[i])), VecLoad(&weights[i])));
+    return VecSum32(sum);
+#else
+    int sum = 0;
+    for (int i = 0; i < NNUE_HIDDEN; ++i)
+        sum += CLAMP(acc[i], 0, NNUE_QA) * weights[i];
+    return sum;
+#endif
+}
+
+// Feature index of a piece as seen by the given side, which always plays up the board
+INLINE const int16_t *Feature(Color view, Piece piece, Square sq) {
+    int relColor = ColorOf(piece) != view;
+    int index = (relColor * 6 + PieceTypeOf(piece) - 1) * 64 + RelativeSquare(view, sq);
+    return Net->featureWeights[index];
+}
+
+void NNUEAddPiece(Accumulator *acc, Piece piece, Square sq) {
+    AddSub(acc->values[WHITE], Feature(WHITE, piece, sq), NULL);
+    AddSub(acc->values[BLACK], Feature(BLACK, piece, sq), NULL);
+}
+
+void NNUERemovePiece(Accumulator *acc, Piece piece, Square sq) {
+    AddSub(acc->values[WHITE], NULL, Feature(WHITE, piece, sq));
+    AddSub(acc->values[BLACK], NULL, Feature(BLACK, piece, sq));
+}
+
+void NNUEMovePiece(Accumulator *acc, Piece piece, Square from, Square to) {
+    AddSub(acc->values[WHITE], Feature(WHITE, piece, to), Feature(WHITE, piece, from));
+    AddSub(acc->values[BLACK], Feature(BLACK, piece, to), Feature(BLACK, piece, from));
+}
+
+// Computes the accumulators from scratch
+void NNUERefresh(Position *pos) {
+
+    if (!NNUEActive) return;
+
+    memcpy(pos->acc.values[WHITE], Net->featureBias, sizeof(Net->featureBias));
+    memcpy(pos->acc.values[BLACK], Net->featureBias, sizeof(Net->featureBias));
+
+    Bitboard pieces = pieceBB(ALL);
+    while (pieces) {
+        Square sq = PopLsb(&pieces);
+        NNUEAddPiece(&pos->acc, pieceOn(sq), sq);
+    }
+}
+
+// Returns the network's evaluation from the side to move's point of view
+int NNUEEvaluate(const Position *pos) {
+
+    int output =  Output(pos->acc.values[sideToMove], Net->outputWeights[0])
+                + Output(pos->acc.values[!sideToMove], Net->outputWeights[1]);
+
+    int eval = (output + Net->outputBias) * NNUE_SCALE / (NNUE_QA * NNUE_QB);
+
+    return CLAMP(eval, -TBWIN_IN_MAX + 1, TBWIN_IN_MAX - 1);
+}
+
+#ifndef NDEBUG
+bool NNUEAccumulatorOk(const Position *pos) {
+
+    if (!NNUEActive) return true;
+
+    Position copy = *pos;
+    NNUERefresh(&copy);
+
+    return !memcmp(&copy.acc, &pos->acc, sizeof(Accumulator));
+}
+#endif
+
+static void UnmapNetwork() {
+
+    if (!mapping) return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(mapping);
+    CloseHandle(mapHandle);
+#else
+    munmap(mapping, mappedSize);
+#endif
+
+    mapping = NULL;
+    Net = NULL;
+    NNUEActive = false;
+}
+
+// Memory maps a network file, returns NULL on failure
+static void *MapNetwork(const char *path, size_t *size) {
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+
+    DWORD sizeHigh, sizeLow = GetFileSize(file, &sizeHigh);
+    *size = ((size_t)sizeHigh << 32) | sizeLow;
+
+    mapHandle = CreateFileMapping(file, NULL, PAGE_READONLY, sizeHigh, sizeLow, NULL);
+    CloseHandle(file);
+    if (!mapHandle) return NULL;
+
+    void *data = MapViewOfFile(mapHandle, FILE_MAP_READ, 0, 0, 0);
+    if (!data) CloseHandle(mapHandle);
+    return data;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) return NULL;
+
+    struct stat statbuf;
+    if (fstat(fd, &statbuf)) {
+        close(fd);
+        return NULL;
+    }
+    *size = statbuf.st_size;
+
+    void *data = mmap(NULL, *size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    return data == MAP_FAILED ? NULL : data;
+#endif
+}
+
+// Loads a network file, an empty path unloads the current one
+bool LoadNetwork(const char *path) {
+
+    UnmapNetwork();
+
+    if (!strncmp(path, "<empty>", 7) || !*path)
+        return false;
+
+    mapping = MapNetwork(path, &mappedSize);
+    if (!mapping) {
+        printf("info string Failed to open network %s\n", path);
+        return false;
+    }
+
+    const NetHeader *header = (const NetHeader *)mapping;
+
+    if (   mappedSize < NET_SIZE
+        || memcmp(header->magic, "WNNU", 4)
+        || header->version != 1
+        || header->inputs != NNUE_INPUTS
+        || header->hidden != NNUE_HIDDEN) {
+        printf("info string Invalid network %s\n", path);
+        UnmapNetwork();
+        return false;
+    }
+
+    Net = (const Network *)(header + 1);
+    NNUEActive = UseNNUE;
+
+    printf("info string Loaded network %s\n", path);
+    return true;
+}
+
+void SetUseNNUE(bool use) {
+    UseNNUE = use;
+    NNUEActive = UseNNUE && Net;
+}
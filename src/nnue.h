@@ -0,0 +1,62 @@
+/*
+  Weiss is a UCI compliant chess engine.
+  Copyright (C) 2023 Terje Kirstihagen
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "types.h"
+
+
+// (768 -> 256)x2 -> 1, one accumulator per perspective
+#define NNUE_INPUTS 768
+#define NNUE_HIDDEN 256
+
+// Quantization of the feature transformer (QA) and output layer (QB), the output bias is scaled by both
+#define NNUE_QA 255
+#define NNUE_QB 64
+#define NNUE_SCALE 400
+
+// Network files are a 64 byte header followed by the int16 parameters:
+// feature weights [768][256], feature bias [256], output weights [2][256], output bias
+typedef struct NetHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t inputs;
+    uint32_t hidden;
+    char reserved[48];
+} NetHeader;
+
+typedef struct Accumulator {
+    int16_t values[COLOR_NB][NNUE_HIDDEN];
+} Accumulator;
+
+struct Position;
+
+extern bool UseNNUE;
+extern bool NNUEActive;
+
+
+bool LoadNetwork(const char *path);
+void SetUseNNUE(bool use);
+void NNUERefresh(struct Position *pos);
+void NNUEAddPiece(Accumulator *acc, Piece piece, Square sq);
+void NNUERemovePiece(Accumulator *acc, Piece piece, Square sq);
+void NNUEMovePiece(Accumulator *acc, Piece piece, Square from, Square to);
+int NNUEEvaluate(const struct Position *pos);
+#ifndef NDEBUG
+bool NNUEAccumulatorOk(const struct Position *pos);
+#endif
@@ -0,0 +1,265 @@
+/*
+  Weiss is a UCI compliant chess engine.
+  Copyright (C) 2023 Terje Kirstihagen
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <atomic>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "board.h"
+#include "makemove.h"
+#include "move.h"
+#include "movegen.h"
+#include "perft.h"
+#include "threads.h"
+#include "time.h"
+#include "transposition.h"
+
+
+// Lockless entry, check is the key xored with the count so torn writes miss
+typedef struct PerftEntry {
+    Key check;
+    uint64_t nodes;
+} PerftEntry;
+
+static PerftEntry *perftTable;
+static uint64_t perftMask;
+
+// Shared by the threads dividing the root moves between them
+static const Position *rootPos;
+static Depth rootDepth;
+static MoveList rootMoves;
+static uint64_t rootCounts[256];
+static std::atomic_int nextRootMove;
+
+
+// Gives the same position a different key at each depth
+INLINE Key PerftKey(const Position *pos, const Depth depth) {
+    return pos->key ^ (depth * 0x9E3779B97F4A7C15ULL);
+}
+
+// Counts leaf nodes, using the number of legal moves directly at depth 1
+static uint64_t RecursivePerft(Position *pos, const Depth depth) {
+
+    MoveList list;
+    list.count = list.next = 0;
+
+    if (depth == 1)
+        return GenLegalMoves(pos, &list), list.count;
+
+    Key key = PerftKey(pos, depth);
+    PerftEntry *entry = &perftTable[key & perftMask];
+    PerftEntry copy = *entry;
+
+    if ((copy.check ^ copy.nodes) == key)
+        return copy.nodes;
+
+    GenLegalMoves(pos, &list);
+
+    uint64_t leafNodes = 0;
+
+    for (int i = 0; i < list.count; ++i) {
+        MakeMove(pos, list.moves[i].move);
+        leafNodes += RecursivePerft(pos, depth - 1);
+        TakeMove(pos);
+    }
+
+    entry->check = key ^ leafNodes;
+    entry->nodes = leafNodes;
+
+    return leafNodes;
+}
+
+// Threads take turns picking the next unsearched root move
+static void *PerftWorker(void *voidThread) {
+
+    Thread *thread = (Thread *)voidThread;
+    Position *pos = &thread->pos;
+    CopyPosition(pos, rootPos);
+
+    for (int i; (i = nextRootMove++) < rootMoves.count; ) {
+        MakeMove(pos, rootMoves.moves[i].move);
+        rootCounts[i] = rootDepth > 1 ? RecursivePerft(pos, rootDepth - 1) : 1;
+        TakeMove(pos);
+    }
+
+    return NULL;
+}
+
+// Allocates a cleared hash table the size of the TT, kept for a whole perft run
+static void InitPerftTable() {
+
+    uint64_t entries = 1;
+    while (2 * entries * sizeof(PerftEntry) <= TT.requestedMB * 1024 * 1024)
+        entries *= 2;
+
+    perftTable = (PerftEntry *)calloc(entries, sizeof(PerftEntry));
+    perftMask = entries - 1;
+
+    if (!perftTable) {
+        printf("Failed to allocate %" PRIu64 "MB for perft.\n", entries * sizeof(PerftEntry) / (1024 * 1024));
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void ClearPerftTable() {
+    memset(perftTable, 0, (perftMask + 1) * sizeof(PerftEntry));
+}
+
+static void FreePerftTable() {
+    free(perftTable);
+    perftTable = NULL;
+}
+
+// Counts leaf nodes using all threads and the perft hash table
+static uint64_t ParallelPerft(const Position *pos, const Depth depth) {
+
+    if (depth == 0) return 1;
+
+    rootPos = pos;
+    rootDepth = depth;
+    rootMoves.count = rootMoves.next = 0;
+    GenLegalMoves(pos, &rootMoves);
+    nextRootMove = 0;
+
+    RunWithAllThreads(PerftWorker);
+
+    uint64_t leafNodes = 0;
+    for (int i = 0; i < rootMoves.count; ++i)
+        leafNodes += rootCounts[i];
+
+    return leafNodes;
+}
+
+void Perft(char *str) {
+
+    const char *default_fen = "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1";
+
+    strtok(str, " ");
+    char *d = strtok(NULL, " ");
+    const char *fen = strtok(NULL, "\0") ?: default_fen;
+
+    Depth depth = d ? atoi(d) : 5;
+    Position pos = {};
+    ParseFen(fen, &pos);
+
+    printf("\nPerft starting:\nDepth : %d\nFEN   : %s\n", depth, fen);
+    fflush(stdout);
+
+    InitPerftTable();
+
+    const TimePoint start = Now();
+    uint64_t leafNodes = ParallelPerft(&pos, depth);
+    const TimePoint elapsed = TimeSince(start) + 1;
+
+    FreePerftTable();
+
+    if (depth > 0) {
+        puts("");
+        for (int i = 0; i < rootMoves.count; ++i)
+            printf("%s: %" PRIu64 "\n", MoveToStr(rootMoves.moves[i].move), rootCounts[i]);
+    }
+
+    printf("\nPerft complete:"
+           "\nTime : %" PRId64 "ms"
+           "\nNPS  : %" PRId64
+           "\nNodes: %" PRIu64 "\n",
+           elapsed, leafNodes * 1000 / elapsed, leafNodes);
+    fflush(stdout);
+
+    FreePosition(&pos);
+}
+
+// Known counts from depth 1 and up, the last five are Chess960 positions
+static const struct {
+    const char *fen;
+    bool chess960;
+    uint64_t counts[6];
+} PerftPositions[] = {
+    { "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", false,
+      { 20, 400, 8902, 197281, 4865609, 119060324 } },
+    { "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", false,
+      { 48, 2039, 97862, 4085603, 193690690 } },
+    { "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", false,
+      { 14, 191, 2812, 43238, 674624, 11030083 } },
+    { "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", false,
+      { 6, 264, 9467, 422333, 15833292 } },
+    { "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", false,
+      { 44, 1486, 62379, 2103487, 89941194 } },
+    { "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", false,
+      { 46, 2079, 89890, 3894594, 164075551 } },
+    { "bqnb1rkr/pp3ppp/3ppn2/2p5/5P2/P2P4/NPP1P1PP/BQ1BNRKR w HFhf - 2 9", true,
+      { 21, 528, 12189, 326672, 8146062 } },
+    { "2nnrbkr/p1qppppp/8/1ppb4/6PP/3PP3/PPP2P2/BQNNRBKR w HEhe - 1 9", true,
+      { 21, 807, 18002, 667366, 16253601 } },
+    { "b1q1rrkb/pppppppp/3nn3/8/P7/1PPP4/4PPPP/BQNNRKRB w GE - 1 9", true,
+      { 20, 479, 10471, 273318, 6417013 } },
+    { "qbbnnrkr/2pp2pp/p7/1p2pp2/8/P3PP2/1PPP1KPP/QBBNNR1R w hf - 0 9", true,
+      { 22, 593, 13440, 382958, 9183776 } },
+    { "1rqbkrbn/1ppppp1p/1n6/p1N3p1/8/2P4P/PP1PPPP1/1RQBKRBN w FBfb - 0 9", true,
+      { 29, 502, 14569, 287739, 8652810 } },
+};
+
+int PerftSuite(int argc, char **argv) {
+
+    // Default max depth 5, 1 thread, 32MB hash
+    Depth maxDepth  = argc > 2 ? atoi(argv[2]) : 5;
+    int threadCount = argc > 3 ? atoi(argv[3]) : 1;
+    TT.requestedMB  = argc > 4 ? atoi(argv[4]) : HASH_DEFAULT;
+
+    InitThreads(threadCount);
+
+    int count = sizeof(PerftPositions) / sizeof(PerftPositions[0]);
+    int failures = 0;
+    uint64_t totalNodes = 0;
+    TimePoint totalElapsed = 1;
+    Position pos = {};
+
+    InitPerftTable();
+
+    for (int i = 0; i < count; ++i) {
+
+        Chess960 = PerftPositions[i].chess960;
+        ParseFen(PerftPositions[i].fen, &pos);
+        ClearPerftTable();
+
+        for (Depth d = 1; d <= maxDepth && d <= 6 && PerftPositions[i].counts[d-1]; ++d) {
+
+            const TimePoint start = Now();
+            uint64_t nodes = ParallelPerft(&pos, d);
+            totalElapsed += TimeSince(start);
+            totalNodes += nodes;
+
+            if (nodes != PerftPositions[i].counts[d-1]) {
+                printf("FAIL depth %d: %" PRIu64 " nodes, expected %" PRIu64 " - %s\n",
+                       d, nodes, PerftPositions[i].counts[d-1], PerftPositions[i].fen);
+                failures++;
+            }
+        }
+    }
+
+    Chess960 = false;
+    FreePosition(&pos);
+    FreePerftTable();
+
+    printf("Perft suite: %d positions, %d failures, %" PRIu64 " nodes %10d nps\n",
+           count, failures, totalNodes, (int)(1000.0 * totalNodes / totalElapsed));
+
+    return failures > 0;
+}
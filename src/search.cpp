@@ -17,8 +17,10 @@
 */
 
 #include <math.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
+#include <thread>
 
 #include "noobprobe/noobprobe.h"
 #include "bitboard.h"
@@ -26,12 +28,15 @@
 #include "evaluate.h"
 #include "history.h"
 #include "makemove.h"
+#include "mate.h"
+#include "mcts.h"
 #include "move.h"
 #include "movepicker.h"
 #include "search.h"
 #include "syzygy.h"
 #include "time.h"
 #include "threads.h"
+#include "trace.h"
 #include "transposition.h"
 #include "uci.h"
 
@@ -40,9 +45,39 @@ SearchLimits Limits = { .multiPV = 1 };
 std::atomic_bool ABORT_SIGNAL;
 std::atomic_bool SEARCH_STOPPED(true);
 std::atomic_bool Minimal(false);
+TimePoint FirstNodeLatency;
+bool YBWCMode = false;
+bool SplitMultiPV = false;
 
 static int Reductions[2][32][32];
 
+// With SplitMultiPV, helpers each take one line. The main thread shares its root
+// moves as ranked by its last iteration, so helpers exclude the same moves it
+// would, and every thread shares the lines it finishes for PrintThinking
+static std::atomic_bool MultiPVLock;
+static RootMove Ranking[256];
+static std::atomic_bool RankingReady;
+static RootMove Finished[256];
+static Depth FinishedDepth[256];
+static int FinishedCount;
+
+// Minimum depth for sharing the moves of a node in YBWC mode
+#define SPLIT_DEPTH 5
+
+static void SplitSearch(Thread *thread, Stack *ss, MovePicker *mp, Depth depth, int beta,
+                        bool pvNode, bool cutnode, bool improving, Move ttMove,
+                        int *alpha, int *bestScore, Move *bestMove, int *moveCount,
+                        Move quiets[], int *quietCount, Move noisys[], int *noisyCount);
+
+// Trace builds log every node through thin wrappers around the searches
+#ifdef SEARCH_TRACE
+#define SEARCH_BODY(name) name##Body
+static int Quiescence(Thread *thread, Stack *ss, int alpha, int beta);
+static int AlphaBeta(Thread *thread, Stack *ss, int alpha, int beta, Depth depth, bool cutnode);
+#else
+#define SEARCH_BODY(name) name
+#endif
+
 
 // Initializes the late move reduction array
 CONSTR(1, InitReductions) {
@@ -52,6 +87,120 @@ CONSTR(1, InitReductions) {
             Reductions[1][depth][moves] = 2.01 + log(depth) * log(moves) / 2.32; // quiet
 }
 
+// Static evaluation of the position, reused from the eval cache when possible
+static int StaticEval(Thread *thread) {
+
+    const Position *pos = &thread->pos;
+    EvalEntry *ee = &thread->evalCache[pos->key % EVAL_CACHE_SIZE];
+
+    StatIncr(evalCacheProbes);
+
+    if (ee->key == pos->key && ee->trend == pos->trend) {
+        StatIncr(evalCacheHits);
+        return ee->eval;
+    }
+
+    ee->key = pos->key;
+    ee->trend = pos->trend;
+    return ee->eval = EvalPosition(pos, &thread->pawnCache, thread->materialCache);
+}
+
+// Static evaluation that may stop early if it clearly fails high against beta, lazy
+// evals are approximate and not cached
+static int LazyStaticEval(Thread *thread, Stack *ss, int beta, bool *lazy) {
+
+    const Position *pos = &thread->pos;
+    EvalEntry *ee = &thread->evalCache[pos->key % EVAL_CACHE_SIZE];
+
+    *lazy = false;
+
+    // Corrections are not linear once the 50 move rule scales the eval
+    if ((ee->key == pos->key && ee->trend == pos->trend) || pos->rule50 > 7 || isTerminal(beta))
+        return StaticEval(thread);
+
+    StatIncr(lazyEvals);
+
+    int threshold = beta - GetCorrectionHistory(thread, ss);
+    int eval = EvalPositionLazy(pos, &thread->pawnCache, thread->materialCache, threshold, lazy);
+
+    if (!*lazy) {
+        ee->key = pos->key;
+        ee->trend = pos->trend;
+        return ee->eval = eval;
+    }
+
+#ifdef DEV
+    int full = EvalPosition(pos, &thread->pawnCache, thread->materialCache);
+    thread->stats.lazyExits++;
+    thread->stats.lazyErrorSum += abs(eval - full);
+    thread->stats.lazyWrongExits += full < threshold;
+#endif
+
+    return eval;
+}
+
+INLINE void LockMultiPV() {
+    while (MultiPVLock.exchange(true, std::memory_order_acquire));
+}
+
+INLINE void UnlockMultiPV() {
+    MultiPVLock.store(false, std::memory_order_release);
+}
+
+// Keeps a finished line if it is the deepest one for its move
+static void ShareLine(const RootMove *line, Depth depth) {
+
+    LockMultiPV();
+
+    int i = 0;
+    while (i < FinishedCount && Finished[i].move != line->move) ++i;
+
+    if (i == FinishedCount || FinishedDepth[i] < depth)
+        Finished[i] = *line, FinishedDepth[i] = depth;
+
+    FinishedCount = MAX(FinishedCount, i + 1);
+
+    UnlockMultiPV();
+}
+
+// The main thread's lines, each replaced by a deeper one for the same move
+// finished by a helper, in score order. Returns the number of lines, at most MULTI_PV_MAX
+int MergedMultiPV(const Thread *thread, RootMove *lines, Depth *depths) {
+
+    int count = MIN(MIN(Limits.multiPV, MULTI_PV_MAX), thread->rootMoveCount);
+
+    for (int i = 0; i < count; ++i)
+        lines[i] = thread->rootMoves[i],
+        depths[i] = thread->depth;
+
+    if (!SplitMultiPV || count < 2) return count;
+
+    LockMultiPV();
+
+    for (int i = 0; i < count; ++i)
+        for (int j = 0; j < FinishedCount; ++j)
+            if (   Finished[j].move == lines[i].move
+                && FinishedDepth[j] > depths[i]
+                && FinishedDepth[j] <= Limits.depth)
+                lines[i] = Finished[j],
+                depths[i] = FinishedDepth[j];
+
+    UnlockMultiPV();
+
+    for (int i = 1; i < count; ++i) {
+        RootMove line = lines[i];
+        Depth depth = depths[i];
+        int j = i - 1;
+        while (j >= 0 && lines[j].score < line.score) {
+            lines[j+1] = lines[j], depths[j+1] = depths[j];
+            --j;
+        }
+        lines[j+1] = line, depths[j+1] = depth;
+    }
+
+    return count;
+}
+
 // Checks whether a move was already searched in multi-pv mode
 static bool AlreadySearchedMultiPV(Thread *thread, Move move) {
     for (int i = 0; i < thread->multiPV; ++i)
@@ -76,12 +225,12 @@ static int DrawScore(Position *pos) {
 // Update the principal variation with the new move and the continuation
 static void UpdatePv(Stack *ss, Move move) {
     ss->pv.length = 1 + (ss+1)->pv.length;
-    ss->pv.line[0] = move;
-    memcpy(ss->pv.line+1, (ss+1)->pv.line, sizeof(Move) * (ss+1)->pv.length);
+    ss->pv.line[0] = PackMove(move);
+    memcpy(ss->pv.line+1, (ss+1)->pv.line, sizeof(PackedMove) * (ss+1)->pv.length);
 }
 
 // Quiescence
-static int Quiescence(Thread *thread, Stack *ss, int alpha, int beta) {
+static int SEARCH_BODY(Quiescence)(Thread *thread, Stack *ss, int alpha, int beta) {
 
     Position *pos = &thread->pos;
     MovePicker mp;
@@ -94,11 +243,14 @@ static int Quiescence(Thread *thread, Stack *ss, int alpha, int beta) {
     int futility = -INFINITE;
     int bestScore = -INFINITE;
     int unadjustedEval = NOSCORE;
+    bool lazy = false;
 
-    // Check time situation
-    if (OutOfTime(thread) || loadRelaxed(ABORT_SIGNAL))
+    // Check time situation, and whether another thread got a cutoff at a split point above
+    if (OutOfTime(thread) || loadRelaxed(ABORT_SIGNAL) || SplitCutoff(thread->splitPoint))
         longjmp(thread->jumpBuffer, true);
 
+    StatDepthIncr(qsNodes);
+
     // Detect upcoming repetitions
     if (alpha < 0 && HasCycle(pos, ss->ply)) {
         alpha = DrawScore(pos);
@@ -116,7 +268,7 @@ static int Quiescence(Thread *thread, Stack *ss, int alpha, int beta) {
 
     // If we are at max depth, return static eval
     if (ss->ply >= MAX_PLY)
-        return EvalPosition(pos, thread->pawnCache);
+        return StaticEval(thread);
 
     // Mate distance pruning
     alpha = MAX(alpha, matedIn(ss->ply));
@@ -128,7 +280,7 @@ static int Quiescence(Thread *thread, Stack *ss, int alpha, int beta) {
     bool ttHit;
     TTEntry *tte = ProbeTT(pos->key, &ttHit);
 
-    Move ttMove = ttHit ? tte->move : NOMOVE;
+    Move ttMove = ttHit ? UnpackMove(pos, tte->move) : NOMOVE;
     int ttScore = ttHit ? ScoreFromTT(tte->score, ss->ply) : NOSCORE;
     int ttEval  = ttHit ? tte->eval : (int32_t)NOSCORE;
     // Depth ttDepth = tte->depth;
@@ -138,17 +290,20 @@ static int Quiescence(Thread *thread, Stack *ss, int alpha, int beta) {
         ttHit = false, ttMove = NOMOVE, ttScore = NOSCORE, ttEval = NOSCORE;
 
     // Trust TT if not a pvnode
-    if (!pvNode && ttHit && TTScoreIsMoreInformative(ttBound, ttScore, beta))
+    if (!pvNode && ttHit && TTScoreIsMoreInformative(ttBound, ttScore, beta)) {
+        TraceEvent(REASON_TT, ttMove, 0, ttScore);
         return ttScore;
+    }
 
     if (inCheck) goto moveloop;
 
-    // Do a static evaluation for pruning considerations
+    // Do a static evaluation for pruning considerations, settling for a partial eval
+    // when it will clearly fail high
     eval = (ss-1)->move == NOMOVE ? -(ss-1)->staticEval + 2 * Tempo
          : ttEval != NOSCORE      ? ttEval
-                                  : EvalPosition(pos, thread->pawnCache);
+                                  : LazyStaticEval(thread, ss, beta, &lazy);
 
-    unadjustedEval = eval;
+    unadjustedEval = lazy ? NOSCORE : eval;
     eval = CorrectEval(thread, ss, eval, pos->rule50);
 
     // Use ttScore as eval if it is more informative
@@ -175,7 +330,7 @@ moveloop:
     Move bestMove = NOMOVE;
     Move move;
     while ((move = NextMove(&mp))) {
-        if (!MoveIsLegal(pos, move)) continue;
+        assert(MoveIsLegal(pos, move));
 
         // Avoid pruning until at least one move avoids a terminal loss score
         if (isLoss(bestScore)) goto search;
@@ -192,7 +347,7 @@ moveloop:
 
         // SEE pruning
         if (    futility <= alpha
-            && !SEE(pos, move, 1)) {
+            && !MoveSEE(&mp, move, 1)) {
             bestScore = MAX(bestScore, futility);
             continue;
         }
@@ -237,7 +392,7 @@ search:
 }
 
 // Alpha Beta
-static int AlphaBeta(Thread *thread, Stack *ss, int alpha, int beta, Depth depth, bool cutnode) {
+static int SEARCH_BODY(AlphaBeta)(Thread *thread, Stack *ss, int alpha, int beta, Depth depth, bool cutnode) {
 
     // Quiescence at the end of search
     if (depth <= 0)
@@ -252,10 +407,12 @@ static int AlphaBeta(Thread *thread, Stack *ss, int alpha, int beta, Depth depth
     const bool root = ss->ply == 0;
     const bool inCheck = pos->checkers;
 
-    // Check time situation
-    if (OutOfTime(thread) || loadRelaxed(ABORT_SIGNAL))
+    // Check time situation, and whether another thread got a cutoff at a split point above
+    if (OutOfTime(thread) || loadRelaxed(ABORT_SIGNAL) || SplitCutoff(thread->splitPoint))
         longjmp(thread->jumpBuffer, true);
 
+    StatDepthIncr(nodes);
+
     // Early exits
     if (!root) {
 
@@ -276,7 +433,7 @@ static int AlphaBeta(Thread *thread, Stack *ss, int alpha, int beta, Depth depth
 
         // Max depth reached
         if (ss->ply >= MAX_PLY)
-            return EvalPosition(pos, thread->pawnCache);
+            return StaticEval(thread);
 
         // Mate distance pruning
         alpha = MAX(alpha, matedIn(ss->ply));
@@ -289,7 +446,7 @@ static int AlphaBeta(Thread *thread, Stack *ss, int alpha, int beta, Depth depth
     bool ttHit;
     TTEntry *tte = ProbeTT(pos->key, &ttHit);
 
-    Move ttMove = ttHit ? tte->move : NOMOVE;
+    Move ttMove = ttHit ? UnpackMove(pos, tte->move) : NOMOVE;
     int ttScore = ttHit ? ScoreFromTT(tte->score, ss->ply) : NOSCORE;
     int ttEval = ttHit ? tte->eval : (int32_t)NOSCORE;
     Depth ttDepth = tte->depth;
@@ -307,6 +464,7 @@ static int AlphaBeta(Thread *thread, Stack *ss, int alpha, int beta, Depth depth
             PawnHistoryUpdate(ttMove, Bonus(depth));
         }
 
+        TraceEvent(REASON_TT, ttMove, depth, ttScore);
         return ttScore;
     }
 
@@ -341,7 +499,7 @@ static int AlphaBeta(Thread *thread, Stack *ss, int alpha, int beta, Depth depth
     int eval = ss->staticEval =  inCheck           ? NOSCORE
                                : lastMoveNullMove  ? -(ss-1)->staticEval + 2 * Tempo
                                : ttEval != NOSCORE ? ttEval
-                                                   : EvalPosition(pos, thread->pawnCache);
+                                                   : StaticEval(thread);
 
     int unadjustedEval = eval;
     ss->staticEval = eval = CorrectEval(thread, ss, eval, pos->rule50);
@@ -368,8 +526,11 @@ static int AlphaBeta(Thread *thread, Stack *ss, int alpha, int beta, Depth depth
     if (   depth < 7
         && eval >= beta
         && eval - 77 * (depth - improving) - (ss-1)->histScore / 131 >= beta
-        && (!ttMove || GetHistory(thread, ss, ttMove) > 6450))
+        && (!ttMove || GetHistory(thread, ss, ttMove) > 6450)) {
+        StatIncr(rfpCutoffs);
+        TraceEvent(REASON_RFP, NOMOVE, depth, eval);
         return eval;
+    }
 
     // Null Move Pruning
     if (   eval >= beta
@@ -384,14 +545,18 @@ static int AlphaBeta(Thread *thread, Stack *ss, int alpha, int beta, Depth depth
         ss->continuation = &thread->continuation[0][0][EMPTY][0];
         ss->contCorr = &thread->contCorrHistory[EMPTY][0];
 
+        StatIncr(nullMoveTries);
+
         MakeNullMove(pos);
         int score = -AlphaBeta(thread, ss+1, -beta, -alpha, depth - reduction, !cutnode);
         TakeNullMove(pos);
 
-        // Cutoff
-        if (score >= beta)
-            // Don't return unproven terminal win scores
+        // Cutoff, but don't return unproven terminal win scores
+        if (score >= beta) {
+            StatIncr(nullMoveCutoffs);
+            TraceEvent(REASON_NULL_MOVE, NOMOVE, depth, score);
             return isWin(score) ? beta : score;
+        }
     }
 
     int probCutBeta = beta + 200;
@@ -401,13 +566,14 @@ static int AlphaBeta(Thread *thread, Stack *ss, int alpha, int beta, Depth depth
         && (!ttHit || ttScore >= probCutBeta)) {
 
         InitProbcutMP(&mp, thread, ss, probCutBeta - ss->staticEval);
+        StatIncr(probcutTries);
 
         Move move;
         while ((move = NextMove(&mp))) {
 
             if (mp.stage > NOISY_GOOD) break;
 
-            if (!MoveIsLegal(pos, move)) continue;
+            assert(MoveIsLegal(pos, move));
             MakeMove(pos, move);
 
             ss->move = move;
@@ -424,8 +590,11 @@ static int AlphaBeta(Thread *thread, Stack *ss, int alpha, int beta, Depth depth
             TakeMove(pos);
 
             // Cut if the reduced depth search beats the threshold, terminal scores are exact
-            if (score >= probCutBeta)
+            if (score >= probCutBeta) {
+                StatIncr(probcutCutoffs);
+                TraceEvent(REASON_PROBCUT, move, depth, score);
                 return isWin(score) ? score : score - 160;
+            }
         }
     }
     }
@@ -449,7 +618,7 @@ move_loop:
         if (move == ss->excluded) continue;
         if (root && AlreadySearchedMultiPV(thread, move)) continue;
         if (root && NotInSearchMoves(Limits.searchmoves, move)) continue;
-        if (!MoveIsLegal(pos, move)) continue;
+        assert(MoveIsLegal(pos, move));
 
         moveCount++;
 
@@ -468,16 +637,25 @@ move_loop:
             Depth lmrDepth = depth - 1 - R;
 
             // Quiet late move pruning
-            if (moveCount > (improving ? 2 + depth * depth : depth * depth / 2))
+            if (!mp.onlyNoisy && moveCount > (improving ? 2 + depth * depth : depth * depth / 2)) {
+                StatIncr(lmpTriggers);
+                TraceEvent(REASON_LMP, move, depth, moveCount);
                 mp.onlyNoisy = true;
+            }
 
             // History pruning
-            if (quiet && lmrDepth < 3 && ss->histScore < -1024 * depth)
+            if (quiet && lmrDepth < 3 && ss->histScore < -1024 * depth) {
+                StatIncr(historyPrunes);
+                TraceEvent(REASON_HISTORY, move, depth, ss->histScore / 16);
                 continue;
+            }
 
             // SEE pruning
-            if (lmrDepth < 7 && !SEE(pos, move, -73 * depth))
+            if (lmrDepth < 7 && !MoveSEE(&mp, move, -73 * depth)) {
+                StatIncr(seePrunes);
+                TraceEvent(REASON_SEE, move, depth, 0);
                 continue;
+            }
         }
 
         // Extension
@@ -497,6 +675,7 @@ move_loop:
 
             // Search to reduced depth with a zero window a bit lower than ttScore
             int singularBeta = ttScore - depth * (2 - pvNode);
+            StatIncr(singularTries);
             ss->excluded = move;
             score = AlphaBeta(thread, ss, singularBeta-1, singularBeta, depth/2, cutnode);
             ss->excluded = NOMOVE;
@@ -507,11 +686,17 @@ move_loop:
                 if (!pvNode && score < singularBeta - 1 && ss->doubleExtensions <= 5)
                     extension = 2;
             // MultiCut - ttMove as well as at least one other move seem good enough to beat beta
-            } else if (singularBeta >= beta)
+            } else if (singularBeta >= beta) {
+                StatIncr(multiCuts);
+                TraceEvent(REASON_MULTICUT, move, depth, singularBeta);
                 return singularBeta;
             // Negative extension - not singular but likely still good enough to beat beta
-            else if (ttScore >= beta)
+            } else if (ttScore >= beta)
                 extension = -1;
+
+            if (extension > 0) StatIncr(singularExtensions);
+            if (extension > 1) StatIncr(doubleExtensions);
+            if (extension < 0) StatIncr(negativeExtensions);
         }
 
         // Extend when in check
@@ -520,6 +705,8 @@ move_loop:
 
 skip_extensions:
 
+        if (extension) TraceEvent(REASON_EXTENSION, move, depth, extension);
+
         MakeMove(pos, move);
 
         ss->move = move;
@@ -552,10 +739,15 @@ skip_extensions:
             // Depth after reductions, avoiding going straight to quiescence as well as extending
             Depth lmrDepth = CLAMP(newDepth - r, 1, newDepth);
 
+            StatIncr(lmrSearches);
+
             score = -AlphaBeta(thread, ss+1, -alpha-1, -alpha, lmrDepth, true);
 
             // Re-search with the same window at full depth if the reduced search failed high
             if (score > alpha && lmrDepth < newDepth) {
+                StatIncr(lmrResearches);
+                TraceEvent(REASON_RESEARCH, move, depth, score);
+
                 bool deeper = score > bestScore + 1 + 6 * (newDepth - lmrDepth);
 
                 newDepth += deeper;
@@ -590,8 +782,8 @@ skip_extensions:
             if (moveCount == 1 || score > alpha) {
                 rm->score = score;
                 rm->pv.length = 1 + (ss+1)->pv.length;
-                rm->pv.line[0] = move;
-                memcpy(rm->pv.line+1, (ss+1)->pv.line, sizeof(Move) * (ss+1)->pv.length);
+                rm->pv.line[0] = PackMove(move);
+                memcpy(rm->pv.line+1, (ss+1)->pv.line, sizeof(PackedMove) * (ss+1)->pv.length);
             } else {
                 rm->score = -INFINITE;
             }
@@ -612,6 +804,8 @@ skip_extensions:
 
                 // If score beats beta we have a cutoff
                 if (score >= beta) {
+                    StatIncr(failHighs);
+                    if (moveCount == 1) StatIncr(firstMoveFailHighs);
                     UpdateHistory(thread, ss, bestMove, depth, quiets, quietCount, noisys, noisyCount);
                     break;
                 }
@@ -623,6 +817,23 @@ skip_extensions:
             quiets[quietCount++] = move;
         else if (!quiet && noisyCount < 32)
             noisys[noisyCount++] = move;
+
+        // Young brothers wait, with the first move searched idle threads can help with the rest
+        if (   YBWCMode
+            && !root
+            && !ss->excluded
+            && depth >= SPLIT_DEPTH
+            && thread->splitCount < MAX_SPLITS
+            && loadRelaxed(IdleThreads)) {
+
+            SplitSearch(thread, ss, &mp, depth, beta, pvNode, cutnode, improving, ttMove,
+                        &alpha, &bestScore, &bestMove, &moveCount,
+                        quiets, &quietCount, noisys, &noisyCount);
+
+            if (bestScore >= beta)
+                UpdateHistory(thread, ss, bestMove, depth, quiets, quietCount, noisys, noisyCount);
+            break;
+        }
     }
 
     // Checkmate or stalemate
@@ -651,6 +862,368 @@ skip_extensions:
     return bestScore;
 }
 
+#ifdef SEARCH_TRACE
+static int Quiescence(Thread *thread, Stack *ss, int alpha, int beta) {
+    TraceNode(TRACE_QS_ENTER, alpha, beta, 0, 0);
+    int score = QuiescenceBody(thread, ss, alpha, beta);
+    TraceNode(TRACE_EXIT, alpha, beta, 0, score);
+    return score;
+}
+
+static int AlphaBeta(Thread *thread, Stack *ss, int alpha, int beta, Depth depth, bool cutnode) {
+    if (depth <= 0)
+        return Quiescence(thread, ss, alpha, beta);
+    TraceNode(TRACE_ENTER, alpha, beta, depth, 0);
+    int score = AlphaBetaBody(thread, ss, alpha, beta, depth, cutnode);
+    TraceNode(TRACE_EXIT, alpha, beta, depth, score);
+    return score;
+}
+#endif
+
+// Full window search of a position inside the MCTS tree, at ply 0 it searches as the root
+int LeafSearch(Thread *thread, Stack *ss, Depth depth) {
+    return AlphaBeta(thread, ss, -INFINITE, INFINITE, depth, false);
+}
+
+// Searches the moves of a split point until they run out or one causes a cutoff,
+// pruning, extending and reducing them the same way as the main move loop
+static void SearchSplitMoves(Thread *thread, Stack *ss, SplitPoint *sp) {
+
+    Position *pos = &thread->pos;
+
+    const bool inCheck = pos->checkers;
+    const Depth depth = sp->depth;
+    const Color opponent = !sideToMove;
+
+    while (true) {
+
+        LockSplit(sp);
+
+        if (loadRelaxed(sp->cutoff) || sp->next >= sp->count) {
+            UnlockSplit(sp);
+            return;
+        }
+
+        Move move = sp->moves[sp->next++];
+        bool quiet = moveIsQuiet(move);
+
+        // The move picker stops giving quiets after late move pruning
+        if (sp->onlyNoisy && quiet && move != sp->killer) {
+            UnlockSplit(sp);
+            continue;
+        }
+
+        int moveCount = ++sp->moveCount;
+        int alpha = sp->alpha;
+        int bestScore = sp->bestScore;
+        bool doPruning = thread->doPruning && !isLoss(bestScore);
+
+        // Quiet late move pruning
+        if (   doPruning
+            && !sp->onlyNoisy
+            && moveCount > (sp->improving ? 2 + depth * depth : depth * depth / 2)) {
+            StatIncr(lmpTriggers);
+            TraceEvent(REASON_LMP, move, depth, moveCount);
+            sp->onlyNoisy = true;
+        }
+
+        UnlockSplit(sp);
+
+        int score;
+
+        ss->histScore = GetHistory(thread, ss, move);
+
+        // Misc pruning
+        if (doPruning) {
+
+            int R = Reductions[quiet][MIN(31, depth)][MIN(31, moveCount)] - ss->histScore / 9164;
+            Depth lmrDepth = depth - 1 - R;
+
+            // History pruning
+            if (quiet && lmrDepth < 3 && ss->histScore < -1024 * depth) {
+                StatIncr(historyPrunes);
+                TraceEvent(REASON_HISTORY, move, depth, ss->histScore / 16);
+                continue;
+            }
+
+            // SEE pruning
+            if (lmrDepth < 7 && !SEE(pos, move, -73 * depth)) {
+                StatIncr(seePrunes);
+                TraceEvent(REASON_SEE, move, depth, 0);
+                continue;
+            }
+        }
+
+        // Extend when in check, singular extensions only concern the tt move which is searched before splitting
+        Depth extension = inCheck && ss->ply < thread->depth * 2;
+
+        if (extension) TraceEvent(REASON_EXTENSION, move, depth, extension);
+
+        MakeMove(pos, move);
+
+        ss->move = move;
+        ss->doubleExtensions = (ss-1)->doubleExtensions;
+        ss->continuation = &thread->continuation[inCheck][moveIsCapture(move)][piece(move)][toSq(move)];
+        ss->contCorr = &thread->contCorrHistory[piece(move)][toSq(move)];
+
+        Depth newDepth = depth - 1 + extension;
+
+        // Reduced depth zero-window search
+        if (   depth > 2
+            && moveCount > MAX(1, sp->pvNode + !sp->ttMove + !quiet)
+            && thread->doPruning) {
+
+            int r = Reductions[quiet][MIN(31, depth)][MIN(31, moveCount)];
+            r -= ss->histScore / 8870;
+            r -= sp->pvNode;
+            r -= sp->improving;
+            r += moveIsCapture(sp->ttMove);
+            r += pos->nonPawnCount[opponent] < 2;
+            r += 2 * sp->cutnode;
+
+            Depth lmrDepth = CLAMP(newDepth - r, 1, newDepth);
+
+            StatIncr(lmrSearches);
+
+            score = -AlphaBeta(thread, ss+1, -alpha-1, -alpha, lmrDepth, true);
+
+            if (score > alpha && lmrDepth < newDepth) {
+                StatIncr(lmrResearches);
+                newDepth += score > bestScore + 1 + 6 * (newDepth - lmrDepth);
+                score = -AlphaBeta(thread, ss+1, -alpha-1, -alpha, newDepth, !sp->cutnode);
+
+                // Update continuation history if the re-search failed high or low
+                if (quiet && (score <= alpha || score >= sp->beta))
+                    UpdateContHistories(ss, move, score >= sp->beta ? Bonus(depth) : Malus(depth));
+            }
+        }
+
+        // Full depth zero-window search
+        else
+            score = -AlphaBeta(thread, ss+1, -alpha-1, -alpha, newDepth, !sp->cutnode);
+
+        // Full depth alpha-beta window search
+        if (sp->pvNode && score > alpha)
+            score = -AlphaBeta(thread, ss+1, -sp->beta, -alpha, newDepth, false);
+
+        TakeMove(pos);
+
+        LockSplit(sp);
+
+        if (score > sp->bestScore) {
+            sp->bestScore = score;
+
+            if (score > sp->alpha) {
+                sp->alpha = score;
+                sp->bestMove = move;
+
+                if (sp->pvNode) {
+                    sp->pv.length = 1 + (ss+1)->pv.length;
+                    sp->pv.line[0] = PackMove(move);
+                    memcpy(sp->pv.line+1, (ss+1)->pv.line, sizeof(PackedMove) * (ss+1)->pv.length);
+                }
+
+                if (score >= sp->beta)
+                    sp->cutoff = true;
+            }
+        }
+
+        // Remember attempted moves for the owner to adjust their history scores
+        if (score < sp->beta) {
+            if (quiet && sp->quietCount < 32)
+                sp->quiets[sp->quietCount++] = move;
+            else if (!quiet && sp->noisyCount < 32)
+                sp->noisys[sp->noisyCount++] = move;
+        }
+
+        UnlockSplit(sp);
+    }
+}
+
+// Copies the split point node and searches its moves, the caller must already count as a slave
+static void JoinSplit(Thread *thread, SplitPoint *sp) {
+
+    Position *pos = &thread->pos;
+    Stack *ss = thread->ss + SS_OFFSET + sp->ss[7].ply;
+    const Thread *master = sp->master;
+    uint64_t nodes = pos->nodes;
+
+    CopyPosition(pos, &sp->pos);
+    pos->nodes = nodes;
+
+    // Point the copied stack at this thread's own history tables
+    memcpy(ss - 7, sp->ss, sizeof(sp->ss));
+    for (Stack *s = ss - 7; s <= ss; ++s)
+        s->continuation = &thread->continuation[0][0][0][0] + (s->continuation - &master->continuation[0][0][0][0]),
+        s->contCorr = &thread->contCorrHistory[0][0] + (s->contCorr - &master->contCorrHistory[0][0]);
+
+    SplitPoint *prevSplit = thread->splitPoint;
+    Depth prevDepth = thread->depth;
+    bool prevPruning = thread->doPruning;
+    jmp_buf prevBuffer;
+    memcpy(prevBuffer, thread->jumpBuffer, sizeof(jmp_buf));
+
+    thread->splitPoint = sp;
+    thread->depth = sp->rootDepth;
+    thread->doPruning = sp->doPruning;
+
+    // Cutoffs and aborts land here, the position is recopied before next use
+    if (!setjmp(thread->jumpBuffer))
+        SearchSplitMoves(thread, ss, sp);
+
+    thread->splitPoint = prevSplit;
+    thread->depth = prevDepth;
+    thread->doPruning = prevPruning;
+    memcpy(thread->jumpBuffer, prevBuffer, sizeof(jmp_buf));
+
+    sp->slaves--;
+}
+
+// Puts the master back at its split point node, when aborted or after helping elsewhere
+static void RestoreSplitNode(Thread *thread, Stack *ss, SplitPoint *sp) {
+    uint64_t nodes = thread->pos.nodes;
+    CopyPosition(&thread->pos, &sp->pos);
+    memcpy(ss - 7, sp->ss, sizeof(sp->ss));
+    thread->pos.nodes = nodes;
+}
+
+// The main thread has to stop even while waiting for slaves
+static bool TimeIsUp(Thread *thread) {
+    return thread->index == 0
+        && (   (Limits.timelimit && TimeSince(Limits.start) >= Limits.maxUsage)
+            || (Limits.nodeTime && thread->pos.nodes >= Limits.nodes));
+}
+
+// Shares the remaining moves of a node with idle threads. The split point is
+// kept by the master thread, which searches moves alongside its slaves and
+// helps with their split points when it runs out of moves itself
+static NOINLINE void SplitSearch(Thread *thread, Stack *ss, MovePicker *mp, Depth depth, int beta,
+                                 bool pvNode, bool cutnode, bool improving, Move ttMove,
+                                 int *alpha, int *bestScore, Move *bestMove, int *moveCount,
+                                 Move quiets[], int *quietCount, Move noisys[], int *noisyCount) {
+
+    Position *pos = &thread->pos;
+    SplitPoint *sp = &thread->splitPoints[thread->splitCount++];
+
+    // The remaining legal moves are shared in the order the move picker gives them
+    sp->count = sp->next = 0;
+    for (Move move; (move = NextMove(mp)); )
+        sp->moves[sp->count++] = move;
+
+    CopyPosition(&sp->pos, pos);
+    memcpy(sp->ss, ss - 7, sizeof(sp->ss));
+
+    sp->parent    = thread->splitPoint;
+    sp->master    = thread;
+    sp->depth     = depth;
+    sp->rootDepth = thread->depth;
+    sp->beta      = beta;
+    sp->pvNode    = pvNode;
+    sp->cutnode   = cutnode;
+    sp->improving = improving;
+    sp->doPruning = thread->doPruning;
+    sp->ttMove    = ttMove;
+    sp->killer    = mp->killer;
+    sp->onlyNoisy = mp->onlyNoisy;
+    sp->alpha     = *alpha;
+    sp->bestScore = *bestScore;
+    sp->bestMove  = *bestMove;
+    sp->moveCount = *moveCount;
+    sp->quietCount = *quietCount;
+    sp->noisyCount = *noisyCount;
+    sp->pv.length = 0;
+    sp->cutoff    = false;
+    sp->slaves    = 0;
+    memcpy(sp->quiets, quiets, sizeof(Move) * *quietCount);
+    memcpy(sp->noisys, noisys, sizeof(Move) * *noisyCount);
+
+    SplitPoint *prevSplit = thread->splitPoint;
+    jmp_buf prevBuffer;
+    memcpy(prevBuffer, thread->jumpBuffer, sizeof(jmp_buf));
+    volatile bool aborted = false;
+
+    thread->splitPoint = sp;
+    OpenSplit(sp);
+
+    // Aborts and cutoffs below land here. Unless it was a cutoff
+    // at this split point the abort is passed on after cleaning up
+    if (!setjmp(thread->jumpBuffer))
+        SearchSplitMoves(thread, ss, sp);
+    else {
+        aborted = !loadRelaxed(sp->cutoff);
+        sp->cutoff = true;
+        RestoreSplitNode(thread, ss, sp);
+    }
+
+    CloseSplit(sp);
+
+    // Wait for the slaves to finish, helping them out in the meantime
+    while (sp->slaves) {
+
+        if (TimeIsUp(thread))
+            aborted = sp->cutoff = true;
+
+        SplitPoint *child = FindSplit(sp);
+
+        if (!child) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        JoinSplit(thread, child);
+        RestoreSplitNode(thread, ss, sp);
+    }
+
+    thread->splitPoint = prevSplit;
+    thread->splitCount--;
+    memcpy(thread->jumpBuffer, prevBuffer, sizeof(jmp_buf));
+
+    if (aborted || loadRelaxed(ABORT_SIGNAL) || SplitCutoff(prevSplit))
+        longjmp(thread->jumpBuffer, true);
+
+    *alpha     = sp->alpha;
+    *bestScore = sp->bestScore;
+    *bestMove  = sp->bestMove;
+    *moveCount = sp->moveCount;
+
+    // The owner updates history with every move searched at the split
+    *quietCount = sp->quietCount;
+    *noisyCount = sp->noisyCount;
+    memcpy(quiets, sp->quiets, sizeof(Move) * sp->quietCount);
+    memcpy(noisys, sp->noisys, sizeof(Move) * sp->noisyCount);
+
+    if (sp->pv.length)
+        ss->pv = sp->pv;
+}
+
+// Helper threads in YBWC mode only search moves at split points they join
+static void *SplitHelper(void *voidThread) {
+
+    Thread *thread = (Thread*)voidThread;
+
+    PrepareThread(thread);
+
+    IdleThreads++;
+
+    while (!loadRelaxed(ABORT_SIGNAL)) {
+
+        SplitPoint *sp = FindSplit(NULL);
+
+        if (!sp) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        IdleThreads--;
+        JoinSplit(thread, sp);
+        IdleThreads++;
+    }
+
+    IdleThreads--;
+
+    return NULL;
+}
+
 // Aspiration window
 static void AspirationWindow(Thread *thread, Stack *ss) {
 
@@ -693,19 +1266,21 @@ static void AspirationWindow(Thread *thread, Stack *ss) {
 
         // Failed low, relax lower bound and search again
         if (score <= alpha) {
+            StatIncr(aspirationFailLows);
             alpha = MAX(alpha - delta, -INFINITE);
             beta  = (alpha + 3 * beta) / 4;
             depth = thread->depth;
 
         // Failed high, relax upper bound and search again
         } else if (score >= beta) {
+            StatIncr(aspirationFailHighs);
             beta = MIN(beta + delta, INFINITE);
             depth = MAX(1, depth - !isTerminal(score));
 
         // Score inside the window
         } else {
             if (multiPV == 0)
-                thread->uncertain = ss->pv.line[0] != thread->rootMoves[0].move;
+                thread->uncertain = ss->pv.line[0] != PackMove(thread->rootMoves[0].move);
 
             return;
         }
@@ -721,7 +1296,13 @@ static void *IterativeDeepening(void *voidThread) {
     Position *pos = &thread->pos;
     Stack *ss = thread->ss+SS_OFFSET;
     bool mainThread = thread->index == 0;
+
+    // Helpers set themselves up in parallel, the main thread is ready already
+    if (!mainThread)
+        PrepareThread(thread);
+
     int multiPV = MIN(Limits.multiPV, thread->rootMoveCount);
+    bool splitLines = SplitMultiPV && multiPV > 1 && !YBWCMode;
 
     // Iterative deepening
     while (++thread->depth <= (mainThread ? Limits.depth : MAX_PLY)) {
@@ -729,13 +1310,42 @@ static void *IterativeDeepening(void *voidThread) {
         // Jump here and return if we run out of allocated time mid-search
         if (setjmp(thread->jumpBuffer)) break;
 
+        // Once the main thread has ranked the root moves, each helper searches
+        // one line, excluding the moves the main thread ranks above it. Helpers
+        // take the last lines first, as the main thread gets to them last
+        if (splitLines && !mainThread && loadRelaxed(RankingReady)) {
+
+            int line = multiPV - 1 - (thread->index - 1) % multiPV;
+
+            LockMultiPV();
+            memcpy(thread->rootMoves, Ranking, thread->rootMoveCount * sizeof(RootMove));
+            UnlockMultiPV();
+
+            thread->multiPV = line;
+            AspirationWindow(thread, ss);
+            ShareLine(&thread->rootMoves[line], thread->depth);
+            continue;
+        }
+
         // Search the position, once for each multi-pv
-        for (thread->multiPV = 0; thread->multiPV < multiPV; ++thread->multiPV)
+        for (int i = 0; i < multiPV; ++i) {
+            thread->multiPV = i;
             AspirationWindow(thread, ss);
+        }
 
         // Sort root moves so they are printed in the right order in multi-pv mode
         SortRootMoves(thread, 0);
 
+        if (splitLines && mainThread) {
+            for (int i = 0; i < multiPV; ++i)
+                ShareLine(&thread->rootMoves[i], thread->depth);
+
+            LockMultiPV();
+            memcpy(Ranking, thread->rootMoves, thread->rootMoveCount * sizeof(RootMove));
+            RankingReady = true;
+            UnlockMultiPV();
+        }
+
         // Only the main thread concerns itself with the rest
         if (!mainThread) continue;
 
@@ -775,15 +1385,27 @@ static void *IterativeDeepening(void *voidThread) {
     return NULL;
 }
 
+// Selects between Lazy SMP, YBWC and MCTS
+void SetSearchMode(const char *mode) {
+    YBWCMode = !strncmp(mode, "YBWC", 4);
+    MCTSMode = !strncmp(mode, "MCTS", 4);
+
+    if (!MCTSMode)
+        FreeMCTSTree();
+}
+
 // Root of search
 void *SearchPosition(void *_pos) {
     Position* pos = (Position*)_pos;
 
-    SEARCH_STOPPED = false;
-
     InitTimeManagement();
     TTNewSearch();
     PrepareSearch(pos, Limits.searchmoves);
+    PrepareThread(&Threads[0]);
+
+#ifdef SEARCH_TRACE
+    TraceStart();
+#endif
 
     // Probe TBs for a move if already in a TB position
     if (SyzygyMove(pos)) goto conclusion;
@@ -791,8 +1413,21 @@ void *SearchPosition(void *_pos) {
     // Probe noobpwnftw's Chess Cloud Database
     if (ProbeNoob(pos)) goto conclusion;
 
+    // Try to prove a mate with the dedicated solver
+    if (Limits.mate && MateSolver && SolveMate()) goto conclusion;
+
+    // Grow a shared tree instead of the usual iterative deepening
+    if (MCTSMode) {
+        SearchMCTS();
+        goto conclusion;
+    }
+
+    RankingReady = false;
+    FinishedCount = 0;
+
     // Start helper threads and begin searching
-    StartHelpers(IterativeDeepening);
+    StartHelpers(YBWCMode ? SplitHelper : IterativeDeepening);
+    FirstNodeLatency = NowMicro() - Limits.startMicro;
     IterativeDeepening(&Threads[0]);
 
 conclusion:
@@ -804,6 +1439,10 @@ conclusion:
     ABORT_SIGNAL = true;
     WaitForHelpers();
 
+#ifdef SEARCH_TRACE
+    TraceStop();
+#endif
+
     // Print the best move found
     PrintBestMove(Threads->rootMoves[0].move);
 
@@ -19,11 +19,12 @@
 #pragma once
 
 #include "board.h"
+#include "threads.h"
 #include "types.h"
 
 
 typedef struct {
-    TimePoint start;
+    TimePoint start, startMicro;
     int time, inc, movestogo, movetime, depth;
     uint64_t nodes;
     int optimalUsage, maxUsage;
@@ -38,6 +39,12 @@ extern SearchLimits Limits;
 extern std::atomic_bool ABORT_SIGNAL;
 extern std::atomic_bool SEARCH_STOPPED;
 extern std::atomic_bool Minimal;
+extern TimePoint FirstNodeLatency;
+extern bool YBWCMode;
+extern bool SplitMultiPV;
 
 
+void SetSearchMode(const char *mode);
 void *SearchPosition(void *pos);
+int LeafSearch(Thread *thread, Stack *ss, Depth depth);
+int MergedMultiPV(const Thread *thread, RootMove *lines, Depth *depths);
@@ -0,0 +1,80 @@
+/*
+  Weiss is a UCI compliant chess engine.
+  Copyright (C) 2023 Terje Kirstihagen
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifdef DEV
+
+#include <stdio.h>
+
+#include "stats.h"
+#include "threads.h"
+
+
+// Adds up the stats of all threads from the last search
+void AddSearchStats(SearchStats *total) {
+
+    const int fields = sizeof(SearchStats) / sizeof(uint64_t);
+
+    for (Thread *t = Threads; t < Threads + Threads->count; ++t)
+        for (int i = 0; i < fields; ++i)
+            ((uint64_t *)total)[i] += ((const uint64_t *)&t->stats)[i];
+}
+
+INLINE double Percent(uint64_t part, uint64_t whole) {
+    return 100.0 * part / MAX(1, whole);
+}
+
+void PrintSearchStats(const SearchStats *s) {
+
+    puts("Search statistics:");
+    printf("  Fail highs        : %12" PRIu64 ", %5.1f%% on the first move\n",
+           s->failHighs, Percent(s->firstMoveFailHighs, s->failHighs));
+    printf("  LMR searches      : %12" PRIu64 ", %5.1f%% re-searched\n",
+           s->lmrSearches, Percent(s->lmrResearches, s->lmrSearches));
+    printf("  Reverse futility  : %12" PRIu64 " cutoffs\n", s->rfpCutoffs);
+    printf("  Null move         : %12" PRIu64 " tries, %5.1f%% cut\n",
+           s->nullMoveTries, Percent(s->nullMoveCutoffs, s->nullMoveTries));
+    printf("  ProbCut           : %12" PRIu64 " tries, %5.1f%% cut\n",
+           s->probcutTries, Percent(s->probcutCutoffs, s->probcutTries));
+    printf("  Late move pruning : %12" PRIu64 " nodes\n", s->lmpTriggers);
+    printf("  History pruning   : %12" PRIu64 " moves\n", s->historyPrunes);
+    printf("  SEE pruning       : %12" PRIu64 " moves\n", s->seePrunes);
+    printf("  SEE tests         : %12" PRIu64 ", %" PRIu64 " computed, %" PRIu64 " saved by the cache\n",
+           s->seeTests, s->seeValues, s->seeTests - s->seeValues);
+    printf("  Singular search   : %12" PRIu64 " tries, %5.1f%% extended, %5.1f%% doubly,"
+           " %5.1f%% multicut, %5.1f%% reduced\n",
+           s->singularTries, Percent(s->singularExtensions, s->singularTries),
+           Percent(s->doubleExtensions, s->singularTries), Percent(s->multiCuts, s->singularTries),
+           Percent(s->negativeExtensions, s->singularTries));
+    printf("  Aspiration        : %12" PRIu64 " fail highs, %" PRIu64 " fail lows\n",
+           s->aspirationFailHighs, s->aspirationFailLows);
+    printf("  Eval cache        : %12" PRIu64 " probes, %5.1f%% hits\n",
+           s->evalCacheProbes, Percent(s->evalCacheHits, s->evalCacheProbes));
+    printf("  Lazy eval         : %12" PRIu64 " tries, %5.1f%% exits, %.1f average error, %" PRIu64 " wrong exits\n",
+           s->lazyEvals, Percent(s->lazyExits, s->lazyEvals),
+           s->lazyExits ? (double)s->lazyErrorSum / s->lazyExits : 0.0, s->lazyWrongExits);
+
+    puts("  Quiescence share of nodes by iteration depth:");
+    for (int d = 0; d <= MAX_PLY; ++d) {
+        uint64_t total = s->nodes[d] + s->qsNodes[d];
+        if (total)
+            printf("    depth %3d : %5.1f%% of %12" PRIu64 " nodes\n",
+                   d, Percent(s->qsNodes[d], total), total);
+    }
+}
+
+#endif
@@ -0,0 +1,54 @@
+/*
+  Weiss is a UCI compliant chess engine.
+  Copyright (C) 2023 Terje Kirstihagen
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "types.h"
+
+
+#ifdef DEV
+
+// Counters of what the search does, only compiled in dev builds
+typedef struct SearchStats {
+    uint64_t nodes[MAX_PLY+1];
+    uint64_t qsNodes[MAX_PLY+1];
+    uint64_t failHighs, firstMoveFailHighs;
+    uint64_t lmrSearches, lmrResearches;
+    uint64_t rfpCutoffs;
+    uint64_t nullMoveTries, nullMoveCutoffs;
+    uint64_t probcutTries, probcutCutoffs;
+    uint64_t lmpTriggers, historyPrunes, seePrunes;
+    uint64_t seeTests, seeValues;
+    uint64_t singularTries, singularExtensions, doubleExtensions, multiCuts, negativeExtensions;
+    uint64_t aspirationFailHighs, aspirationFailLows;
+    uint64_t evalCacheProbes, evalCacheHits;
+    uint64_t lazyEvals, lazyExits, lazyErrorSum, lazyWrongExits;
+} SearchStats;
+
+#define StatIncr(term) thread->stats.term++
+#define StatDepthIncr(term) thread->stats.term[MIN(thread->depth, MAX_PLY)]++
+
+void AddSearchStats(SearchStats *total);
+void PrintSearchStats(const SearchStats *stats);
+
+#else
+
+#define StatIncr(term) ((void)0)
+#define StatDepthIncr(term) ((void)0)
+
+#endif
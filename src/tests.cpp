@@ -16,15 +16,18 @@
   along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "board.h"
+#include "evalbatch.h"
 #include "evaluate.h"
 #include "makemove.h"
 #include "move.h"
 #include "movegen.h"
 #include "search.h"
+#include "stats.h"
 #include "threads.h"
 #include "tests.h"
 #include "time.h"
@@ -95,19 +98,24 @@ typedef struct BenchResult {
 
 void Benchmark(int argc, char **argv) {
 
-    // Default depth 16, 1 thread, and 32MB hash
+    // Default depth 16, 1 thread, 32MB hash, and the normal search mode
     Limits.depth     = argc > 2 ? atoi(argv[2]) : 16;
     int threadCount  = argc > 3 ? atoi(argv[3]) : 1;
     TT.requestedMB   = argc > 4 ? atoi(argv[4]) : HASH_DEFAULT;
+    SetSearchMode(argc > 5 ? argv[5] : "AlphaBeta");
 
-    Position pos;
+    Position pos = {};
     InitThreads(threadCount);
     InitTT();
 
     int FENCount = sizeof(BenchmarkFENs) / sizeof(char *);
     BenchResult results[FENCount];
     TimePoint totalElapsed = 1; // Avoid possible div/0
+    TimePoint totalLatency = 0;
     uint64_t totalNodes = 0;
+#ifdef DEV
+    SearchStats totalStats = {};
+#endif
 
     for (int i = 0; i < FENCount; ++i) {
 
@@ -117,6 +125,7 @@ void Benchmark(int argc, char **argv) {
         ParseFen(BenchmarkFENs[i], &pos);
         ABORT_SIGNAL = false;
         Limits.start = Now();
+        Limits.startMicro = NowMicro();
         SearchPosition(&pos);
 
         // Collect results
@@ -128,6 +137,11 @@ void Benchmark(int argc, char **argv) {
 
         totalElapsed += r->elapsed;
         totalNodes   += r->nodes;
+        totalLatency += FirstNodeLatency;
+
+#ifdef DEV
+        AddSearchStats(&totalStats);
+#endif
 
         ClearTT();
     }
@@ -143,62 +157,346 @@ void Benchmark(int argc, char **argv) {
 
     puts("======================================================");
 
+#ifdef DEV
+    PrintSearchStats(&totalStats);
+
+    puts("======================================================");
+#endif
+
+    printf("LATENCY: %7" PRIi64 " us from go to first node on average\n",
+           totalLatency / FENCount);
+
     printf("OVERALL: %7" PRIi64 " ms %13" PRIu64 " nodes %10d nps\n",
            totalElapsed, totalNodes, (int)(1000.0 * totalNodes / totalElapsed));
+
+    FreePosition(&pos);
 }
 
-#ifdef DEV
+// Compares how Lazy SMP, YBWC and MCTS scale with the thread count, searching
+// the first few bench positions for a fixed time with each
+void SMPBenchmark(int argc, char **argv) {
 
-// Helper for Perft()
-static uint64_t RecursivePerft(Position *pos, const Depth depth) {
+    // Default 1s per position, at 64, 128 and 256 threads
+    int movetime = argc > 2 ? atoi(argv[2]) : 1000;
+    int defaultCounts[] = { 64, 128, 256 };
+    int countCount = argc > 3 ? argc - 3 : 3;
 
-    if (depth == 0) return 1;
+    const int FENCount = 8;
+    const char *modes[] = { "AlphaBeta", "YBWC", "MCTS" };
 
-    uint64_t leafnodes = 0;
+    Position pos = {};
+    Minimal = true;
+    TT.requestedMB = HASH_DEFAULT;
 
-    MoveList list;
-    list.count = list.next = 0;
-    GenAllMoves(pos, &list);
+    puts("======================================================");
+
+    for (int c = 0; c < countCount; ++c) {
+
+        int threadCount = argc > 3 ? atoi(argv[3 + c]) : defaultCounts[c];
+        InitThreads(threadCount);
+        InitTT();
+
+        for (int mode = 0; mode < 3; ++mode) {
+
+            SetSearchMode(modes[mode]);
+            TimePoint elapsed = 1;
+            uint64_t nodes = 0;
+            int depth = 0;
+
+            for (int i = 0; i < FENCount; ++i) {
+
+                ParseFen(BenchmarkFENs[i], &pos);
+                memset(&Limits, 0, offsetof(SearchLimits, multiPV));
+                Limits.movetime = movetime;
+                Limits.timelimit = true;
+                Limits.depth = MAX_PLY;
+                ABORT_SIGNAL = false;
+                Limits.start = Now();
+                Limits.startMicro = NowMicro();
+                SearchPosition(&pos);
 
-    for (int i = 0; i < list.count; i++) {
-        if (!MoveIsLegal(pos, list.moves[i].move)) continue;
-        MakeMove(pos, list.moves[i].move);
-        leafnodes += RecursivePerft(pos, depth - 1);
-        TakeMove(pos);
+                elapsed += TimeSince(Limits.start);
+                nodes   += TotalNodes();
+                depth   += Threads->depth;
+
+                ClearTT();
+            }
+
+            printf("SMP: %4d threads %-10s %13" PRIu64 " nodes %10d nps %5.1f depth\n",
+                   threadCount, modes[mode], nodes, (int)(1000.0 * nodes / elapsed),
+                   (double)depth / FENCount);
+        }
     }
 
-    return leafnodes;
+    puts("======================================================");
+
+    SetSearchMode("AlphaBeta");
+    FreePosition(&pos);
 }
 
-// Counts number of moves that can be made in a position to some depth
-void Perft(char *str) {
+// Collects the bench positions and their children
+static int CollectBenchPositions(Position *positions, int max) {
 
-    const char *default_fen = "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1";
+    int FENCount = sizeof(BenchmarkFENs) / sizeof(char *);
+    int count = 0;
+    Position pos = {};
 
-    strtok(str, " ");
-    char *d = strtok(NULL, " ");
-    const char *fen = strtok(NULL, "\0") ?: default_fen;
+    for (int i = 0; i < FENCount && count < max; ++i) {
+        ParseFen(BenchmarkFENs[i], &pos);
+        CopyPosition(&positions[count++], &pos);
 
-    Depth depth = d ? atoi(d) : 5;
-    ParseFen(fen, &Threads->pos);
+        MoveList list;
+        list.count = list.next = 0;
+        GenLegalMoves(&pos, &list);
 
-    printf("\nPerft starting:\nDepth : %d\nFEN   : %s\n", depth, fen);
-    fflush(stdout);
+        for (int j = 0; j < list.count && count < max; ++j) {
+            MakeMove(&pos, list.moves[j].move);
+            CopyPosition(&positions[count++], &pos);
+            TakeMove(&pos);
+        }
+    }
 
-    const TimePoint start = Now();
-    uint64_t leafNodes = RecursivePerft(&Threads->pos, depth);
-    const TimePoint elapsed = TimeSince(start) + 1;
+    FreePosition(&pos);
 
-    printf("\nPerft complete:"
-           "\nTime : %" PRId64 "ms"
-           "\nNPS  : %" PRId64
-           "\nNodes: %" PRIu64 "\n",
-           elapsed, leafNodes * 1000 / elapsed, leafNodes);
-    fflush(stdout);
+    return count;
 }
 
+// Collects the legal moves of a position along with the moves of nearby bench
+// positions that are pseudo-legal in it, the kind of candidates TT moves and killers are
+static int CollectCandidates(const Position *positions, int count, int i, Move *moves) {
+
+    int n = 0;
+
+    for (int k = MAX(0, i - 8); k < MIN(count, i + 9); ++k) {
+
+        MoveList list;
+        list.count = list.next = 0;
+        GenAllMoves(&positions[k], &list);
+
+        for (int j = 0; j < list.count && n < 256; ++j) {
+
+            Move move = list.moves[j].move;
+
+            if (!MoveIsPseudoLegal(&positions[i], move))
+                continue;
+
+            bool seen = false;
+            for (int m = 0; m < n && !seen; ++m)
+                seen = moves[m] == move;
+
+            if (!seen)
+                moves[n++] = move;
+        }
+    }
+
+    return n;
+}
+
+// Times the legality test using the pinned pieces kept by MakeMove against the
+// full king safety test, and the cost of finding the pinned pieces in the first place
+void LegalityBenchmark(int argc, char **argv) {
+
+    int iterations = argc > 2 ? atoi(argv[2]) : 1000;
+
+    static Position positions[4096];
+    int count = CollectBenchPositions(positions, 4096);
+
+    uint64_t checks = 0, illegal = 0, mismatches = 0, pinned = 0;
+    TimePoint fastTime = 0, fullTime = 0, pinnedTime = 0;
+
+    for (int i = 0; i < count; ++i) {
+
+        const Position *p = &positions[i];
+        Move moves[256];
+        int n = CollectCandidates(positions, count, i, moves);
+
+        bool fast[256], full[256];
+        TimePoint start = NowMicro();
+        for (int it = 0; it < iterations; ++it)
+            for (int j = 0; j < n; ++j)
+                fast[j] = MoveIsLegal(p, moves[j]);
+        fastTime += NowMicro() - start;
+
+        start = NowMicro();
+        for (int it = 0; it < iterations; ++it)
+            for (int j = 0; j < n; ++j)
+                full[j] = KingSafeAfter(p, moves[j]);
+        fullTime += NowMicro() - start;
+
+        start = NowMicro();
+        for (int it = 0; it < iterations; ++it)
+            pinned += PopCount(Pinned(p));
+        pinnedTime += NowMicro() - start;
+
+        for (int j = 0; j < n; ++j)
+            mismatches += fast[j] != full[j],
+            illegal += !full[j];
+        checks += n;
+    }
+
+    double fastNs   = 1000.0 * fastTime   / (checks * iterations);
+    double fullNs   = 1000.0 * fullTime   / (checks * iterations);
+    double pinnedNs = 1000.0 * pinnedTime / ((uint64_t)count * iterations);
+
+    printf("Positions      : %d, %" PRIu64 " pseudo-legal moves, %" PRIu64 " illegal\n", count, checks, illegal);
+    printf("Mismatches     : %" PRIu64 " between the two tests\n", mismatches);
+    printf("Pinned lookup  : %6.2f ns per legality test\n", fastNs);
+    printf("Full king test : %6.2f ns per legality test\n", fullNs);
+    printf("Finding pins   : %6.2f ns per position (%.2f pins on average)\n", pinnedNs, (double)pinned / count / iterations);
+    if (fullNs > fastNs)
+        printf("Pins pay off once a node tests more than %.1f moves\n", pinnedNs / (fullNs - fastNs));
+}
+
+// Times move generation alone, noisy then quiet moves as the movepicker asks for them
+void MoveGenBenchmark(int argc, char **argv) {
+
+    int iterations = argc > 2 ? atoi(argv[2]) : 10000;
+
+    static Position positions[4096];
+    int count = CollectBenchPositions(positions, 4096);
+
+    uint64_t moves = 0, checksum = 0;
+    TimePoint start = NowMicro();
+
+    for (int it = 0; it < iterations; ++it)
+        for (int i = 0; i < count; ++i) {
+            MoveList list;
+            list.count = list.next = 0;
+            GenNoisyMoves(&positions[i], &list);
+            GenQuietMoves(&positions[i], &list);
+            moves += list.count;
+            checksum += list.moves[list.count / 2].move;
+        }
+
+    TimePoint elapsed = MAX(1, NowMicro() - start);
+
+    printf("Positions      : %d, %" PRIu64 " moves each pass\n", count, moves / iterations);
+    printf("Generation     : %6.2f ns per position, %6.2f ns per move\n",
+           1000.0 * elapsed / ((uint64_t)count * iterations), 1000.0 * elapsed / moves);
+    printf("Checksum       : %" PRIu64 "\n", checksum);
+}
+
+// Times making and taking back every legal move of the bench positions and their children
+void MakeMoveBenchmark(int argc, char **argv) {
+
+    int iterations = argc > 2 ? atoi(argv[2]) : 1000;
+
+    static Position positions[4096];
+    int count = CollectBenchPositions(positions, 4096);
+
+    uint64_t moves = 0, checksum = 0;
+    TimePoint elapsed = 0;
+
+    for (int i = 0; i < count; ++i) {
+
+        Position *pos = &positions[i];
+        MoveList list;
+        list.count = list.next = 0;
+        GenLegalMoves(pos, &list);
+
+        TimePoint start = NowMicro();
+        for (int it = 0; it < iterations; ++it)
+            for (int j = 0; j < list.count; ++j) {
+                MakeMove(pos, list.moves[j].move);
+                checksum += pos->key;
+                TakeMove(pos);
+            }
+        elapsed += NowMicro() - start;
+
+        moves += list.count;
+    }
+
+#ifdef COPY_MAKE
+    const char *mode = "copy-make";
+#else
+    const char *mode = "make/unmake";
+#endif
+
+    printf("Positions      : %d, %" PRIu64 " moves, %s\n", count, moves, mode);
+    printf("Make + take    : %6.2f ns per move\n", 1000.0 * elapsed / (MAX(1, moves) * iterations));
+    printf("Checksum       : %" PRIu64 "\n", checksum);
+}
+
+// Times batch evaluation of positions from random games starting at the bench
+// positions, against parsing and evaluating them one FEN at a time
+void EvalBenchmark(int argc, char **argv) {
+
+    // Default 1M positions and 1 thread
+    size_t count    = argc > 2 ? strtoull(argv[2], NULL, 10) : 1000000;
+    int threadCount = argc > 3 ? atoi(argv[3]) : 1;
+    size_t fenCount = MIN(count, (size_t)100000);
+
+    PackedPos *positions = (PackedPos *)malloc(count * sizeof(PackedPos));
+    int16_t *evals = (int16_t *)malloc(count * sizeof(int16_t));
+    char (*fens)[100] = (char (*)[100])malloc(fenCount * sizeof(*fens));
+
+    int FENCount = sizeof(BenchmarkFENs) / sizeof(char *);
+    uint64_t seed = 0x9E3779B97F4A7C15;
+    Position pos = {};
+
+    // Random games of up to 64 plies, packing every position along the way
+    for (size_t n = 0, game = 0; n < count; ++game) {
+
+        ParseFen(BenchmarkFENs[game % FENCount], &pos);
+
+        for (int ply = 0; ply < 64 && n < count; ++ply) {
+
+            MoveList list;
+            list.count = list.next = 0;
+            GenLegalMoves(&pos, &list);
+            if (!list.count) break;
+
+            seed ^= seed << 13, seed ^= seed >> 7, seed ^= seed << 17;
+            MakeMove(&pos, list.moves[seed % list.count].move);
+
+            if (n < fenCount)
+                strcpy(fens[n], BoardToFen(&pos));
+            PackPosition(&pos, &positions[n++]);
+        }
+    }
+
+    InitThreads(threadCount);
+
+    TimePoint start = NowMicro();
+    EvalBatch(positions, count, evals);
+    TimePoint batchTime = MAX(1, NowMicro() - start);
+
+    // The way labelling used to be done, reusing the caches the batch warmed up
+    uint64_t mismatches = 0;
+    start = NowMicro();
+    for (size_t i = 0; i < fenCount; ++i) {
+        ParseFen(fens[i], &pos);
+        mismatches += EvalPositionWhitePov(&pos, &Threads->pawnCache, Threads->materialCache) != evals[i];
+    }
+    TimePoint fenTime = MAX(1, NowMicro() - start);
+
+    int64_t checksum = 0;
+    for (size_t i = 0; i < count; ++i)
+        checksum += evals[i];
+
+    printf("Positions      : %zu, %d threads\n", count, threadCount);
+    printf("Batch          : %10.0f positions/sec\n", 1e6 * count / batchTime);
+    printf("FEN at a time  : %10.0f positions/sec, 1 thread, %" PRIu64 " mismatches\n", 1e6 * fenCount / fenTime, mismatches);
+    printf("Checksum       : %" PRId64 "\n", checksum);
+
+    free(positions);
+    free(evals);
+    free(fens);
+    FreePosition(&pos);
+}
+
+#ifdef DEV
+
 void PrintEval(Position *pos) {
-    printf("%d\n", EvalPositionWhitePov(pos, Threads->pawnCache));
+    printf("%d\n", EvalPositionWhitePov(pos, &Threads->pawnCache, Threads->materialCache));
     fflush(stdout);
 }
+
+// Prints the search statistics of the last search
+void PrintLastSearchStats() {
+    SearchStats stats = {};
+    AddSearchStats(&stats);
+    PrintSearchStats(&stats);
+}
+
 #endif
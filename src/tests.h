@@ -23,8 +23,13 @@
 
 
 void Benchmark(int argc, char **argv);
+void SMPBenchmark(int argc, char **argv);
+void LegalityBenchmark(int argc, char **argv);
+void MoveGenBenchmark(int argc, char **argv);
+void MakeMoveBenchmark(int argc, char **argv);
+void EvalBenchmark(int argc, char **argv);
 
 #ifdef DEV
-void Perft(char *line);
 void PrintEval(Position *pos);
+void PrintLastSearchStats();
 #endif
@@ -18,9 +18,12 @@
 
 #include <pthread.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "move.h"
 #include "movegen.h"
 #include "threads.h"
 
@@ -28,6 +31,20 @@
 Thread *Threads;
 static pthread_t *pthreads;
 
+// Pawn caches, either one per thread or a single one shared by all
+int PawnHashMB = PAWN_HASH_DEFAULT;
+bool SharedPawnHash = false;
+static void *pawnMem;
+static uint64_t pawnBytes;
+
+// Split points idle threads can join in YBWC mode
+#define MAX_OPEN_SPLITS 1024
+
+std::atomic_int IdleThreads;
+static SplitPoint *openSplits[MAX_OPEN_SPLITS];
+static int openSplitCount;
+static std::atomic_bool openSplitLock;
+
 // Used for letting the main thread sleep without using cpu
 static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t sleepCondition = PTHREAD_COND_INITIALIZER;
@@ -36,6 +53,13 @@ static pthread_cond_t sleepCondition = PTHREAD_COND_INITIALIZER;
 // Allocates memory for thread structs
 void InitThreads(int count) {
 
+    // Positions keep their history outside the thread struct
+    for (int i = 0; Threads && i < Threads->count; ++i) {
+        FreePosition(&Threads[i].pos);
+        for (int j = 0; j < MAX_SPLITS; ++j)
+            FreePosition(&Threads[i].splitPoints[j].pos);
+    }
+
     if (Threads)  free(Threads);
     if (pthreads) free(pthreads);
 
@@ -46,6 +70,42 @@ void InitThreads(int count) {
     for (int i = 0; i < count; ++i)
         Threads[i].index = i,
         Threads[i].count = count;
+
+    // The ply of each stack entry never changes
+    for (Thread *t = Threads; t < Threads + count; ++t)
+        for (Depth d = 0; d <= MAX_PLY; ++d)
+            (t->ss+SS_OFFSET+d)->ply = d;
+
+    InitPawnCaches();
+}
+
+// Allocates the pawn caches, sized to the largest power of two entries that fit
+void InitPawnCaches() {
+
+    uint64_t entries = 1;
+    while (2 * entries * sizeof(PawnEntry) <= (uint64_t)PawnHashMB * 1024 * 1024)
+        entries *= 2;
+
+    int tables = SharedPawnHash ? 1 : Threads->count;
+
+    if (pawnMem)
+        free(pawnMem);
+
+    // Align on cache line
+    pawnBytes = tables * entries * sizeof(PawnEntry);
+    pawnMem = malloc(pawnBytes + 64 - 1);
+
+    if (!pawnMem) {
+        printf("Failed to allocate %dMB for pawn cache.\n", PawnHashMB * tables);
+        exit(EXIT_FAILURE);
+    }
+
+    PawnEntry *table = (PawnEntry *)(((uintptr_t)pawnMem + 64 - 1) & ~(64 - 1));
+    memset(table, 0, pawnBytes);
+
+    for (int i = 0; i < Threads->count; ++i)
+        Threads[i].pawnCache.table = table + (SharedPawnHash ? 0 : i * entries),
+        Threads[i].pawnCache.mask  = entries - 1;
 }
 
 // Sorts all rootmoves beginning from the given index
@@ -79,38 +139,81 @@ uint64_t TotalTBHits() {
     return total;
 }
 
-// Setup threads for a new search
+// Root position and moves of the current search, copied by each thread in PrepareThread
+static const Position *rootPos;
+static Move rootMoveList[256];
+static int rootMoveCount;
+
+// Setup for a new search, the per-thread work is left to PrepareThread
 void PrepareSearch(Position *pos, Move searchmoves[]) {
 
     MoveList legalMoves;
     legalMoves.count = legalMoves.next = 0;
     GenLegalMoves(pos, &legalMoves);
 
-    RootMove rootMoves[256] = {};
-    int rootMoveCount = 0;
+    // The network may have been loaded or enabled since the position was set up
+    NNUERefresh(pos);
+
+    rootPos = pos;
+    rootMoveCount = 0;
 
     // Add legal searchmoves to the root moves by checking if it is in the legalMoves list
     for (Move *move = searchmoves; *move; ++move)
         for (int i = 0; i < legalMoves.count; ++i)
             if (legalMoves.moves[i].move == *move)
-                rootMoves[rootMoveCount++].move = *move;
+                rootMoveList[rootMoveCount++] = *move;
 
     // If no searchmoves are provided, add all legal moves to the root moves
     if (!rootMoveCount)
         for (int i = 0; i < legalMoves.count; ++i)
-            rootMoves[rootMoveCount++].move = legalMoves.moves[i].move;
+            rootMoveList[rootMoveCount++] = legalMoves.moves[i].move;
 
-    for (Thread *t = Threads; t < Threads + Threads->count; ++t) {
-        memset(t, 0, offsetof(Thread, pos));
-        memcpy(&t->pos, pos, sizeof(Position));
-        memcpy(t->rootMoves, rootMoves, sizeof(rootMoves));
-        t->rootMoveCount = rootMoveCount;
-        for (Depth d = 0; d <= MAX_PLY; ++d)
-            (t->ss+SS_OFFSET+d)->ply = d;
-        for (Depth d = -7; d < 0; ++d)
-            (t->ss+SS_OFFSET+d)->continuation = &t->continuation[0][0][EMPTY][0],
-            (t->ss+SS_OFFSET+d)->contCorr = &t->contCorrHistory[EMPTY][0];
-    }
+    rootMoveList[rootMoveCount] = NOMOVE;
+
+    // Counters are read across threads, so are reset before any thread starts
+    for (Thread *t = Threads; t < Threads + Threads->count; ++t)
+        t->pos.nodes = 0,
+        t->tbhits = 0;
+}
+
+// Resets the search state of a thread, called by each thread before it starts searching
+void PrepareThread(Thread *thread) {
+
+    Position *pos = &thread->pos;
+
+    // Copy the root position, only the part of the history that is in use is needed
+    CopyPosition(pos, rootPos);
+    pos->nodes = 0;
+
+    // Clear key history for seldepth calculation
+    for (int i = pos->histPly; i < pos->histPly + SEARCH_HISTORY; ++i)
+        pos->gameHistory[i].key = 0;
+
+    thread->depth = 0;
+    thread->doPruning = false;
+    thread->uncertain = false;
+    thread->multiPV = 0;
+    thread->splitPoint = NULL;
+    thread->splitCount = 0;
+#ifdef DEV
+    memset(&thread->stats, 0, sizeof(SearchStats));
+#endif
+
+    // Reset the search stack, leaving the pv lines as they are
+    for (Stack *ss = thread->ss; ss < thread->ss + 128; ++ss)
+        ss->continuation = &thread->continuation[0][0][EMPTY][0],
+        ss->contCorr = &thread->contCorrHistory[EMPTY][0],
+        ss->staticEval = ss->histScore = ss->doubleExtensions = 0,
+        ss->move = ss->excluded = ss->killer = NOMOVE,
+        ss->pv.length = 0;
+
+    // Copy the root moves, including the terminating NOMOVE
+    thread->rootMoveCount = rootMoveCount;
+    for (int i = 0; i <= rootMoveCount; ++i)
+        thread->rootMoves[i].move = rootMoveList[i],
+        thread->rootMoves[i].score = 0,
+        thread->rootMoves[i].nodes = 0,
+        thread->rootMoves[i].pv.length = 0;
 }
 
 // Start the main thread running the provided function
@@ -136,10 +239,18 @@ void WaitForHelpers() {
     helpersActive = false;
 }
 
+// Clears the cached evaluations, which go stale when the evaluation changes
+void ClearEvalCaches() {
+    for (int i = 0; i < Threads->count; ++i)
+        memset(Threads[i].evalCache,     0, sizeof(EvalCache)),
+        memset(Threads[i].materialCache, 0, sizeof(MaterialCache));
+}
+
 // Reset all data that isn't reset each turn
 void ResetThreads() {
+    memset(Threads->pawnCache.table, 0, pawnBytes);
+    ClearEvalCaches();
     for (int i = 0; i < Threads->count; ++i)
-        memset(Threads[i].pawnCache,       0, sizeof(PawnCache)),
         memset(Threads[i].history,         0, sizeof(Threads[i].history)),
         memset(Threads[i].pawnHistory,     0, sizeof(Threads[i].pawnHistory)),
         memset(Threads[i].captureHistory,  0, sizeof(Threads[i].captureHistory)),
@@ -172,3 +283,62 @@ void Wake() {
     pthread_cond_signal(&sleepCondition);
     pthread_mutex_unlock(&mutex);
 }
+
+INLINE void LockOpenSplits() {
+    while (openSplitLock.exchange(true, std::memory_order_acquire));
+}
+
+INLINE void UnlockOpenSplits() {
+    openSplitLock.store(false, std::memory_order_release);
+}
+
+// Lets idle threads join a split point, if there is room
+void OpenSplit(SplitPoint *sp) {
+    LockOpenSplits();
+    if (openSplitCount < MAX_OPEN_SPLITS)
+        openSplits[openSplitCount++] = sp;
+    UnlockOpenSplits();
+}
+
+// Stops any more threads from joining a split point
+void CloseSplit(SplitPoint *sp) {
+    LockOpenSplits();
+    for (int i = 0; i < openSplitCount; ++i)
+        if (openSplits[i] == sp) {
+            openSplits[i] = openSplits[--openSplitCount];
+            break;
+        }
+    UnlockOpenSplits();
+}
+
+// Steals work from the deepest open split point that still has moves left,
+// optionally only below a given split point. The caller becomes a slave of it
+SplitPoint *FindSplit(const SplitPoint *ancestor) {
+
+    SplitPoint *best = NULL;
+
+    LockOpenSplits();
+
+    for (int i = 0; i < openSplitCount; ++i) {
+
+        SplitPoint *sp = openSplits[i];
+
+        if (loadRelaxed(sp->cutoff) || sp->next >= sp->count)
+            continue;
+
+        if (ancestor) {
+            const SplitPoint *p = sp->parent;
+            while (p && p != ancestor) p = p->parent;
+            if (!p) continue;
+        }
+
+        if (!best || sp->depth > best->depth)
+            best = sp;
+    }
+
+    if (best) best->slaves++;
+
+    UnlockOpenSplits();
+
+    return best;
+}
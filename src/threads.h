@@ -22,11 +22,13 @@
 
 #include "board.h"
 #include "evaluate.h"
+#include "stats.h"
 #include "types.h"
 
 
 #define SS_OFFSET 10
 #define MULTI_PV_MAX 64
+#define MAX_SPLITS 8
 #define PAWN_HISTORY_SIZE 512
 #define CORRECTION_HISTORY_SIZE 16384
 
@@ -59,8 +61,36 @@ typedef struct RootMove {
     PV pv;
 } RootMove;
 
+// A node in YBWC mode where the remaining moves are shared with idle threads
+typedef struct SplitPoint {
+    Position pos;
+    Stack ss[8];
+    struct SplitPoint *parent;
+    struct Thread *master;
+    Move moves[256];
+    int count, next;
+    Depth depth, rootDepth;
+    int beta;
+    bool pvNode, cutnode, improving, doPruning;
+    Move ttMove, killer;
+
+    // Shared results, protected by the lock
+    std::atomic_bool lock;
+    int alpha, bestScore, moveCount;
+    int quietCount, noisyCount;
+    Move bestMove;
+    Move quiets[32];
+    Move noisys[32];
+    bool onlyNoisy;
+    PV pv;
+
+    std::atomic_bool cutoff;
+    std::atomic_int slaves;
+} SplitPoint;
+
 typedef struct Thread {
 
+    // Reset by each thread at the start of a search, see PrepareThread
     Stack ss[128];
     jmp_buf jumpBuffer;
     uint64_t tbhits;
@@ -70,10 +100,17 @@ typedef struct Thread {
     int multiPV;
     int rootMoveCount;
     RootMove rootMoves[256];
-
-    // Anything below here is not zeroed out between searches
+    SplitPoint *splitPoint;
+    int splitCount;
+#ifdef DEV
+    SearchStats stats;
+#endif
     Position pos;
+
+    // Anything below here is not reset between searches
     PawnCache pawnCache;
+    EvalCache evalCache;
+    MaterialCache materialCache;
     ButterflyHistory history;
     PawnHistory pawnHistory;
     CaptureToHistory captureHistory;
@@ -83,6 +120,7 @@ typedef struct Thread {
     CorrectionHistory majorCorrHistory;
     CorrectionHistory nonPawnCorrHistory[COLOR_NB];
     ContiuationCorrectionHistory contCorrHistory;
+    SplitPoint splitPoints[MAX_SPLITS];
 
     int index;
     int count;
@@ -91,17 +129,42 @@ typedef struct Thread {
 
 
 extern Thread *Threads;
+extern std::atomic_int IdleThreads;
+extern int PawnHashMB;
+extern bool SharedPawnHash;
 
 
 void InitThreads(int threadCount);
+void InitPawnCaches();
 void SortRootMoves(Thread *thread, int begin);
 uint64_t TotalNodes();
 uint64_t TotalTBHits();
 void PrepareSearch(Position *pos, Move searchmoves[]);
+void PrepareThread(Thread *thread);
 void StartMainThread(void *(*func)(void *), Position *pos);
 void StartHelpers(void *(*func)(void *));
 void WaitForHelpers();
+void ClearEvalCaches();
 void ResetThreads();
 void RunWithAllThreads(void *(*func)(void *));
 void Wait(std::atomic_bool *condition);
 void Wake();
+void OpenSplit(SplitPoint *sp);
+void CloseSplit(SplitPoint *sp);
+SplitPoint *FindSplit(const SplitPoint *ancestor);
+
+INLINE void LockSplit(SplitPoint *sp) {
+    while (sp->lock.exchange(true, std::memory_order_acquire));
+}
+
+INLINE void UnlockSplit(SplitPoint *sp) {
+    sp->lock.store(false, std::memory_order_release);
+}
+
+// Whether any split point the thread is working under has been cut off
+INLINE bool SplitCutoff(const SplitPoint *sp) {
+    for (; sp; sp = sp->parent)
+        if (loadRelaxed(sp->cutoff))
+            return true;
+    return false;
+}
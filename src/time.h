@@ -33,5 +33,12 @@ INLINE int TimeSince(const TimePoint tp) {
     return Now() - tp;
 }
 
+// Microsecond resolution, used to measure search setup latency
+INLINE TimePoint NowMicro() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000 + t.tv_nsec / 1000;
+}
+
 void InitTimeManagement();
 bool OutOfTime(Thread *thread);
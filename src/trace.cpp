@@ -0,0 +1,192 @@
+/*
+  Weiss is a UCI compliant chess engine.
+  Copyright (C) 2023 Terje Kirstihagen
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "move.h"
+#include "trace.h"
+
+
+#ifdef SEARCH_TRACE
+
+#define TRACE_BUFFER 4096
+#define TRACE_LIMIT_MB 1024
+
+static char TraceFile[1024];
+
+static FILE *traceOut;
+static TraceRecord buffer[TRACE_BUFFER];
+static int buffered;
+static uint64_t written;
+
+
+static void Flush() {
+    fwrite(buffer, sizeof(TraceRecord), buffered, traceOut);
+    written += buffered;
+    buffered = 0;
+
+    // Stop tracing once the file is big enough
+    if (written * sizeof(TraceRecord) >= (uint64_t)TRACE_LIMIT_MB << 20)
+        TraceStop();
+}
+
+// An empty path disables tracing
+void SetTraceFile(const char *path) {
+    if (!strncmp(path, "<empty>", 7))
+        path = "";
+    snprintf(TraceFile, sizeof(TraceFile), "%s", path);
+}
+
+// Opens the trace file for a new search, if one is set
+void TraceStart() {
+    if (TraceFile[0] && !(traceOut = fopen(TraceFile, "wb")))
+        printf("info string Failed to open trace file %s\n", TraceFile);
+    buffered = 0;
+    written = 0;
+}
+
+void TraceStop() {
+    if (!traceOut) return;
+    fwrite(buffer, sizeof(TraceRecord), buffered, traceOut);
+    fclose(traceOut);
+    traceOut = NULL;
+    buffered = 0;
+}
+
+void TraceWrite(int kind, int reason, Key key, Move move, int ply, int depth, int alpha, int beta, int score) {
+
+    if (!traceOut) return;
+
+    buffer[buffered++] = { key, move, (int16_t)alpha, (int16_t)beta, (int16_t)score,
+                           (uint8_t)ply, (int8_t)depth, (uint8_t)kind, (uint8_t)reason };
+
+    if (buffered == TRACE_BUFFER)
+        Flush();
+}
+
+#endif
+
+static const char *ReasonNames[] = {
+    "", "tt cutoff", "reverse futility", "null move", "probcut", "late move pruning",
+    "history pruning", "see pruning", "extension", "multicut", "re-search", "singular search"
+};
+
+// Usage: weiss tracequery <file> [depth D] [plies N] [moves m1 m2 ...]
+// Prints the tree below the given moves from the root, for iterations of depth D
+void TraceQuery(int argc, char **argv) {
+
+    if (argc < 3) {
+        puts("Usage: tracequery <file> [depth D] [plies N] [moves m1 m2 ...]");
+        return;
+    }
+
+    int iteration = -1, plies = 2;
+    char **path = NULL;
+    int pathLength = 0;
+
+    for (int i = 3; i < argc; ++i) {
+        if      (!strcmp(argv[i], "depth") && i + 1 < argc) iteration = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "plies") && i + 1 < argc) plies = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "moves")) {
+            path = &argv[i+1];
+            pathLength = argc - i - 1;
+            break;
+        }
+    }
+
+    // Read the whole trace
+    FILE *file = fopen(argv[2], "rb");
+    if (!file) {
+        printf("Failed to open %s\n", argv[2]);
+        return;
+    }
+
+    fseek(file, 0, SEEK_END);
+    size_t count = ftell(file) / sizeof(TraceRecord);
+    fseek(file, 0, SEEK_SET);
+
+    TraceRecord *records = (TraceRecord *)malloc(count * sizeof(TraceRecord) + 1);
+    count = fread(records, sizeof(TraceRecord), count, file);
+    fclose(file);
+
+    // Match each node with its exit, nodes left by a time abort have none
+    size_t *exits = (size_t *)malloc(count * sizeof(size_t) + 1);
+    size_t stack[256];
+    int height = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+        exits[i] = count;
+        if (records[i].kind == TRACE_ENTER || records[i].kind == TRACE_QS_ENTER) {
+            if (records[i].ply == 0) height = 0;
+            if (height < 256) stack[height++] = i;
+        } else if (records[i].kind == TRACE_EXIT && height)
+            exits[stack[--height]] = i;
+    }
+
+    // Print the matching part of the tree
+    Move line[256];
+    int rootDepth = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+
+        const TraceRecord *r = &records[i];
+
+        if (r->kind == TRACE_EXIT) continue;
+
+        if (r->kind != TRACE_EVENT) {
+            line[r->ply] = r->move;
+            if (r->ply == 0)
+                rootDepth = r->depth;
+        }
+
+        if (iteration != -1 && rootDepth != iteration) continue;
+        if (r->ply < pathLength || r->ply > pathLength + plies) continue;
+
+        bool onPath = true;
+        for (int p = 0; p < pathLength && onPath; ++p)
+            onPath = !strcmp(MoveToStr(line[p+1]), path[p]);
+        if (!onPath) continue;
+
+        // Events are indented below the node they happened in
+        printf("%*s", 2 * (r->ply - pathLength + (r->kind == TRACE_EVENT)), "");
+
+        if (r->kind == TRACE_EVENT) {
+            printf("- %s", ReasonNames[r->reason]);
+            if (r->move) printf(" %s", MoveToStr(r->move));
+            if (r->reason == REASON_EXTENSION) printf(" %+d", r->score);
+            printf("\n");
+            continue;
+        }
+
+        printf("%s%s%s d%d [%d, %d]", r->ply ? MoveToStr(r->move) : "root",
+               r->kind == TRACE_QS_ENTER ? " qs" : "", r->reason == REASON_SINGULAR ? " singular" : "",
+               r->depth, r->alpha, r->beta);
+
+        if (exits[i] == count)
+            printf(" aborted\n");
+        else {
+            int score = records[exits[i]].score;
+            printf(" = %d %s\n", score, score >= r->beta  ? "cut"
+                                      : score <= r->alpha ? "all" : "pv");
+        }
+    }
+
+    free(records);
+    free(exits);
+}
@@ -0,0 +1,62 @@
+/*
+  Weiss is a UCI compliant chess engine.
+  Copyright (C) 2023 Terje Kirstihagen
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "types.h"
+
+
+// Binary log of the search tree of the main thread, see 'make trace'
+enum TraceKind { TRACE_ENTER, TRACE_QS_ENTER, TRACE_EXIT, TRACE_EVENT };
+
+enum TraceReason {
+    REASON_NONE, REASON_TT, REASON_RFP, REASON_NULL_MOVE, REASON_PROBCUT, REASON_LMP,
+    REASON_HISTORY, REASON_SEE, REASON_EXTENSION, REASON_MULTICUT, REASON_RESEARCH, REASON_SINGULAR
+};
+
+typedef struct TraceRecord {
+    Key key;
+    Move move;
+    int16_t alpha, beta, score;
+    uint8_t ply;
+    int8_t depth;
+    uint8_t kind, reason;
+} TraceRecord;
+
+
+void TraceQuery(int argc, char **argv);
+
+#ifdef SEARCH_TRACE
+
+void SetTraceFile(const char *path);
+void TraceStart();
+void TraceStop();
+void TraceWrite(int kind, int reason, Key key, Move move, int ply, int depth, int alpha, int beta, int score);
+
+// Only the main thread is traced
+#define TraceNode(kind, alpha, beta, depth, score) \
+    (thread->index == 0 ? TraceWrite(kind, ss->excluded ? REASON_SINGULAR : REASON_NONE, thread->pos.key, (ss-1)->move, ss->ply, depth, alpha, beta, score) : (void)0)
+#define TraceEvent(reason, move, depth, score) \
+    (thread->index == 0 ? TraceWrite(TRACE_EVENT, reason, thread->pos.key, move, ss->ply, depth, 0, 0, score) : (void)0)
+
+#else
+
+#define TraceNode(kind, alpha, beta, depth, score) ((void)0)
+#define TraceEvent(reason, move, depth, score) ((void)0)
+
+#endif
@@ -23,6 +23,7 @@
     #include <sys/mman.h>
 #endif
 
+#include "move.h"
 #include "transposition.h"
 
 
@@ -53,7 +54,7 @@ void StoreTTEntry(TTEntry *tte, Key key, Move move, int score, int eval, Depth d
     assert(ValidScore(score));
 
     if (move || (int32_t)key != tte->key)
-        tte->move = move;
+        tte->move = PackMove(move);
 
     // Store new data unless it would overwrite data about the same
     // position searched to a higher depth.
@@ -92,7 +93,7 @@ static void *ThreadClearTT(void *voidThread) {
     uint64_t begin  = MIN(size, index * blocks * twoMB);
     uint64_t end    = MIN(size, begin + blocks * twoMB);
 
-    memset(TT.table + begin / sizeof(TTBucket), 0, end - begin);
+    memset((char *)TT.table + begin, 0, end - begin);
 
     return NULL;
 }
@@ -28,7 +28,7 @@
 #define HASH_MAX ((int)(pow(2, 40) * sizeof(TTBucket) / (1024 * 1024))) // 40 could be set as high as 64
 #define HASH_DEFAULT 32
 
-#define BUCKET_SIZE 2
+#define BUCKET_SIZE 5
 
 #define ValidBound(bound) (bound >= BOUND_UPPER && bound <= BOUND_EXACT)
 #define ValidScore(score) (score >= -MATE && score <= MATE)
@@ -48,17 +48,24 @@ enum {
 
 typedef struct {
     int32_t key;
-    Move move;
     int16_t score;
     int16_t eval;
+    PackedMove move;
     uint8_t depth;
     uint8_t genBound;
 } TTEntry;
 
+static_assert(sizeof(TTEntry) == 12, "TTEntry should be 12 bytes");
+
+// Five entries and padding fill a cache line, so a probe
+// only touches the line TTPrefetch fetched
 typedef struct {
-    TTEntry entries[2];
+    TTEntry entries[BUCKET_SIZE];
+    uint8_t padding[4];
 } TTBucket;
 
+static_assert(sizeof(TTBucket) == 64, "TTBucket should fill a cache line");
+
 typedef struct {
     void *mem;
     TTBucket *table;
@@ -0,0 +1,326 @@
+/*
+  Weiss is a UCI compliant chess engine.
+  Copyright (C) 2023 Terje Kirstihagen
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifdef TRAIN
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+#include "../bitboard.h"
+#include "../board.h"
+#include "trainer.h"
+
+
+typedef struct TrainEntry {
+    uint16_t features[32]; // From white's point of view
+    uint8_t count;
+    Color stm;
+    float result;
+} TrainEntry;
+
+typedef struct Params {
+    float featureWeights[NNUE_INPUTS][NNUE_HIDDEN];
+    float featureBias[NNUE_HIDDEN];
+    float outputWeights[COLOR_NB][NNUE_HIDDEN];
+    float outputBias;
+} Params;
+
+#define NPARAMS ((int)(sizeof(Params) / sizeof(float)))
+
+
+// Same indexing as Feature() in nnue.cpp
+INLINE int FeatureIndex(Piece piece, Square sq) {
+    return ((ColorOf(piece) != WHITE) * 6 + PieceTypeOf(piece) - 1) * 64 + sq;
+}
+
+// Converts a white feature to black's point of view: swap colors and mirror
+INLINE int FlipFeature(int index) {
+    return (index < 384 ? index + 384 : index - 384) ^ 56;
+}
+
+static TrainEntry *ReadBook(const char *path, int *count) {
+
+    FILE *fin = fopen(path, "r");
+    if (!fin) {
+        printf("Cannot open %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+
+    int capacity = 1 << 20;
+    TrainEntry *entries = (TrainEntry *)malloc(capacity * sizeof(TrainEntry));
+    Position position = {}, *pos = &position;
+    char line[256];
+
+    *count = 0;
+
+    while (fgets(line, sizeof(line), fin)) {
+
+        if (*count == capacity)
+            entries = (TrainEntry *)realloc(entries, (capacity *= 2) * sizeof(TrainEntry));
+
+        TrainEntry *entry = &entries[*count];
+
+        if      (strstr(line, "[1.0]")) entry->result = 1.0;
+        else if (strstr(line, "[0.5]")) entry->result = 0.5;
+        else if (strstr(line, "[0.0]")) entry->result = 0.0;
+        else    { printf("Cannot Parse %s\n", line); continue; }
+
+        ParseFen(line, pos);
+
+        // Results are from white's point of view, the network's output from the side to move's
+        entry->stm = sideToMove;
+        if (sideToMove == BLACK)
+            entry->result = 1.0 - entry->result;
+        entry->count = 0;
+
+        Bitboard pieces = pieceBB(ALL);
+        while (pieces && entry->count < 32) {
+            Square sq = PopLsb(&pieces);
+            entry->features[entry->count++] = FeatureIndex(pieceOn(sq), sq);
+        }
+
+        (*count)++;
+    }
+
+    fclose(fin);
+    FreePosition(pos);
+
+    return entries;
+}
+
+static void InitParams(Params *params) {
+
+    srand(1);
+
+    #define Uniform(range) ((range) * (2.0f * rand() / RAND_MAX - 1.0f))
+
+    for (int i = 0; i < NNUE_INPUTS; ++i)
+        for (int j = 0; j < NNUE_HIDDEN; ++j)
+            params->featureWeights[i][j] = Uniform(0.1f);
+
+    for (int j = 0; j < NNUE_HIDDEN; ++j)
+        params->featureBias[j] = 0.1f,
+        params->outputWeights[WHITE][j] = Uniform(0.1f),
+        params->outputWeights[BLACK][j] = Uniform(0.1f);
+
+    params->outputBias = 0;
+}
+
+// Forward and backward pass of one position, returns the squared error
+static double Backprop(const Params *params, const TrainEntry *entry, Params *grad) {
+
+    float acc[COLOR_NB][NNUE_HIDDEN];
+    int features[COLOR_NB][32];
+
+    // Perspective 0 is the side to move, matching the order of the output weights
+    for (int i = 0; i < entry->count; ++i) {
+        int white = entry->features[i], black = FlipFeature(white);
+        features[0][i] = entry->stm == WHITE ? white : black;
+        features[1][i] = entry->stm == WHITE ? black : white;
+    }
+
+    float output = params->outputBias;
+
+    for (int side = 0; side < COLOR_NB; ++side) {
+
+        float *a = acc[side];
+        memcpy(a, params->featureBias, sizeof(params->featureBias));
+
+        for (int i = 0; i < entry->count; ++i) {
+            const float *weights = params->featureWeights[features[side][i]];
+            #pragma omp simd
+            for (int j = 0; j < NNUE_HIDDEN; ++j)
+                a[j] += weights[j];
+        }
+
+        const float *weights = params->outputWeights[side];
+        #pragma omp simd reduction(+:output)
+        for (int j = 0; j < NNUE_HIDDEN; ++j)
+            output += CLAMP(a[j], 0.0f, 1.0f) * weights[j];
+    }
+
+    // Loss is the squared error of the win probability
+    double E = output * NNUE_SCALE;
+    double S = 1.0 / (1.0 + exp(-TRAIN_K * E / 400.0));
+    double X = 2 * (S - entry->result) * S * (1 - S) * TRAIN_K * NNUE_SCALE / 400.0;
+
+    grad->outputBias += X;
+
+    for (int side = 0; side < COLOR_NB; ++side) {
+
+        const float *a = acc[side];
+        const float *weights = params->outputWeights[side];
+        float *outGrad = grad->outputWeights[side];
+        float delta[NNUE_HIDDEN];
+
+        #pragma omp simd
+        for (int j = 0; j < NNUE_HIDDEN; ++j) {
+            outGrad[j] += X * CLAMP(a[j], 0.0f, 1.0f);
+            delta[j] = a[j] > 0.0f && a[j] < 1.0f ? X * weights[j] : 0.0f;
+            grad->featureBias[j] += delta[j];
+        }
+
+        // Only the rows of active features get a gradient
+        for (int i = 0; i < entry->count; ++i) {
+            float *row = grad->featureWeights[features[side][i]];
+            #pragma omp simd
+            for (int j = 0; j < NNUE_HIDDEN; ++j)
+                row[j] += delta[j];
+        }
+    }
+
+    return (S - entry->result) * (S - entry->result);
+}
+
+static void AdamStep(Params *params, const Params *grad, Params *momentum, Params *velocity, double rate, int batchSize) {
+
+    float *p = (float *)params, *m = (float *)momentum, *v = (float *)velocity;
+    const float *g = (const float *)grad;
+
+    #pragma omp parallel for simd
+    for (int i = 0; i < NPARAMS; ++i) {
+        float gradient = g[i] / batchSize;
+        m[i] = TRAIN_BETA_1 * m[i] + (1.0 - TRAIN_BETA_1) * gradient;
+        v[i] = TRAIN_BETA_2 * v[i] + (1.0 - TRAIN_BETA_2) * gradient * gradient;
+        p[i] -= rate * m[i] / (1e-8 + sqrt(v[i]));
+    }
+
+    for (int j = 0; j < NNUE_HIDDEN; ++j)
+        params->outputWeights[WHITE][j] = CLAMP(params->outputWeights[WHITE][j], -OUTPUT_CLIP, OUTPUT_CLIP),
+        params->outputWeights[BLACK][j] = CLAMP(params->outputWeights[BLACK][j], -OUTPUT_CLIP, OUTPUT_CLIP);
+}
+
+INLINE int16_t Quantize(float value, int scale) {
+    return CLAMP(lrintf(value * scale), INT16_MIN, INT16_MAX);
+}
+
+// Writes the network in the format LoadNetwork expects
+static void SaveNetwork(const Params *params, const char *path) {
+
+    FILE *fout = fopen(path, "wb");
+    if (!fout) {
+        printf("Cannot write %s\n", path);
+        return;
+    }
+
+    NetHeader header = { { 'W', 'N', 'N', 'U' }, 1, NNUE_INPUTS, NNUE_HIDDEN, { 0 } };
+    fwrite(&header, sizeof(header), 1, fout);
+
+    static int16_t featureWeights[NNUE_INPUTS][NNUE_HIDDEN];
+    int16_t featureBias[NNUE_HIDDEN], outputWeights[COLOR_NB][NNUE_HIDDEN];
+
+    for (int i = 0; i < NNUE_INPUTS; ++i)
+        for (int j = 0; j < NNUE_HIDDEN; ++j)
+            featureWeights[i][j] = Quantize(params->featureWeights[i][j], NNUE_QA);
+
+    for (int j = 0; j < NNUE_HIDDEN; ++j)
+        featureBias[j] = Quantize(params->featureBias[j], NNUE_QA),
+        outputWeights[WHITE][j] = Quantize(params->outputWeights[WHITE][j], NNUE_QB),
+        outputWeights[BLACK][j] = Quantize(params->outputWeights[BLACK][j], NNUE_QB);
+
+    int16_t outputBias = Quantize(params->outputBias, NNUE_QA * NNUE_QB);
+
+    fwrite(featureWeights, sizeof(featureWeights), 1, fout);
+    fwrite(featureBias, sizeof(featureBias), 1, fout);
+    fwrite(outputWeights, sizeof(outputWeights), 1, fout);
+    fwrite(&outputBias, sizeof(outputBias), 1, fout);
+    fclose(fout);
+}
+
+void Train(int argc, char **argv) {
+
+    if (argc < 3) {
+        puts("Usage: train <book> [epochs] [output]");
+        return;
+    }
+
+    int epochs = argc > 3 ? atoi(argv[3]) : TRAIN_EPOCHS;
+    const char *output = argc > 4 ? argv[4] : "weiss.nnue";
+
+    int count;
+    TrainEntry *entries = ReadBook(argv[2], &count);
+    int *order = (int *)malloc(count * sizeof(int));
+    for (int i = 0; i < count; ++i)
+        order[i] = i;
+
+    Params *params   = (Params *)calloc(1, sizeof(Params));
+    Params *grad     = (Params *)calloc(1, sizeof(Params));
+    Params *momentum = (Params *)calloc(1, sizeof(Params));
+    Params *velocity = (Params *)calloc(1, sizeof(Params));
+    InitParams(params);
+
+    printf("Training %d parameters on %d positions from %s using %d threads\n",
+           NPARAMS, count, argv[2], omp_get_max_threads());
+
+    double rate = TRAIN_LR;
+
+    for (int epoch = 1; epoch <= epochs; ++epoch) {
+
+        // Shuffle the positions
+        for (int i = count - 1; i > 0; --i) {
+            int j = rand() % (i + 1), tmp = order[i];
+            order[i] = order[j], order[j] = tmp;
+        }
+
+        double error = 0;
+
+        for (int start = 0; start < count; start += BATCH_SIZE) {
+
+            int end = MIN(count, start + BATCH_SIZE);
+
+            memset(grad, 0, sizeof(Params));
+
+            #pragma omp parallel reduction(+:error)
+            {
+                Params *local = (Params *)calloc(1, sizeof(Params));
+
+                #pragma omp for schedule(static)
+                for (int i = start; i < end; ++i)
+                    error += Backprop(params, &entries[order[i]], local);
+
+                #pragma omp critical
+                {
+                    float *g = (float *)grad, *l = (float *)local;
+                    #pragma omp simd
+                    for (int i = 0; i < NPARAMS; ++i)
+                        g[i] += l[i];
+                }
+
+                free(local);
+            }
+
+            AdamStep(params, grad, momentum, velocity, rate, end - start);
+        }
+
+        printf("Epoch [%d] Error = [%.8f], Rate = [%g]\n", epoch, error / count, rate);
+
+        // Pre-scheduled Learning Rate drops
+        if (epoch % TRAIN_LR_STEP == 0) rate *= TRAIN_LR_DROP;
+
+        SaveNetwork(params, output);
+    }
+
+    printf("Saved network to %s\n", output);
+
+    free(entries), free(order);
+    free(params), free(grad), free(momentum), free(velocity);
+}
+
+#endif
@@ -0,0 +1,44 @@
+/*
+  Weiss is a UCI compliant chess engine.
+  Copyright (C) 2023 Terje Kirstihagen
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+  Mini-batch Adam trainer for the network in nnue.h, using the same
+  labelled FEN books as the tuner: "<fen> [1.0]" per line.
+
+  Usage: weiss train <book> [epochs] [output]
+*/
+
+#pragma once
+
+#ifdef TRAIN
+
+#define TRAIN_EPOCHS  (       30) // Default number of passes over the data
+#define BATCH_SIZE    (    16384) // Positions per gradient step
+#define TRAIN_LR      (    0.001) // Adam learning rate
+#define TRAIN_LR_DROP (      0.3) // Cut LR by this each LR-step
+#define TRAIN_LR_STEP (       10) // Cut LR after this many epochs
+#define TRAIN_K       (     2.25) // Sigmoid scaling, matching the tuner
+#define TRAIN_BETA_1  (      0.9) // ADAM Momemtum Coefficient
+#define TRAIN_BETA_2  (    0.999) // ADAM Velocity Coefficient
+#define OUTPUT_CLIP   (     1.98) // Keeps quantized output weights within int8 range
+
+
+// Trains a network and writes it to a file the engine can load with EvalFile
+void Train(int argc, char **argv);
+
+#endif
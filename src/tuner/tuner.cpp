@@ -35,7 +35,7 @@
 #include "tuner.h"
 
 
-EvalTrace T, EmptyTrace;
+static EvalTrace T;
 
 TTuple *TupleStack;
 int TupleStackSize;
@@ -364,8 +364,9 @@ static void InitTunerEntry(TEntry *entry, Position *pos, int *danger) {
     entry->phase = pos->phase;
 
     // Save a white POV static evaluation
-    TCoeffs coeffs; T = EmptyTrace;
-    entry->seval = EvalPositionWhitePov(pos, NULL);
+    TCoeffs coeffs;
+    int eval = EvalPositionTrace(pos, &T);
+    entry->seval = pos->stm == WHITE ? eval : -eval;
 
     // evaluate() -> [[NTERMS][COLOUR_NB]]
     InitCoefficients(coeffs);
@@ -380,7 +381,7 @@ static void InitTunerEntry(TEntry *entry, Position *pos, int *danger) {
 
 static void InitTunerEntries(TEntry *entries, TVector baseParams) {
 
-    Position pos;
+    Position pos = {};
     char line[128];
     FILE *fin = fopen(DATASET, "r");
 
@@ -409,6 +410,8 @@ static void InitTunerEntries(TEntry *entries, TVector baseParams) {
             exit(0);
         }
     }
+
+    FreePosition(&pos);
 }
 
 static double Sigmoid(double K, double E) {
@@ -31,14 +31,6 @@
 #include "../types.h"
 
 
-#define TRACE (1)
-#define TraceCount(term) T.term[color] += count
-#define TraceIncr(term) T.term[color]++
-#define TraceScale(s) T.scale = s
-#define TraceEval(e) T.eval = e
-#define TraceDanger(d) T.danger[color] = d
-
-
 // #define DATASET      "../../Datasets/Andrew/BIG.book"
 // #define NPOSITIONS   ( 42484641) // Total FENS in the book
 
@@ -62,46 +54,6 @@
 #define STACKSIZE ((int)((double) NPOSITIONS * NTERMS / 64))
 
 
-typedef struct EvalTrace {
-
-    int eval;
-    int scale;
-    int danger[COLOR_NB];
-
-    int PieceValue[5][COLOR_NB];
-    int PSQT[6][64][COLOR_NB];
-
-    int PawnDoubled[COLOR_NB];
-    int PawnDoubled2[COLOR_NB];
-    int PawnIsolated[COLOR_NB];
-    int PawnSupport[COLOR_NB];
-    int PawnThreat[COLOR_NB];
-    int PushThreat[COLOR_NB];
-    int PawnOpen[COLOR_NB];
-    int BishopPair[COLOR_NB];
-    int KingAtkPawn[COLOR_NB];
-    int OpenForward[COLOR_NB];
-    int SemiForward[COLOR_NB];
-    int NBBehindPawn[COLOR_NB];
-    int BishopBadP[COLOR_NB];
-    int Shelter[COLOR_NB];
-
-    int PawnPassed[RANK_NB][COLOR_NB];
-    int PassedDefended[RANK_NB][COLOR_NB];
-    int PassedBlocked[RANK_NB][COLOR_NB];
-    int PassedFreeAdv[RANK_NB][COLOR_NB];
-    int PassedDistUs[RANK_NB][COLOR_NB];
-    int PassedDistThem[COLOR_NB];
-    int PassedRookBack[COLOR_NB];
-    int PassedSquare[COLOR_NB];
-    int PawnPhalanx[RANK_NB][COLOR_NB];
-    int ThreatByMinor[8][COLOR_NB];
-    int ThreatByRook[8][COLOR_NB];
-    int KingLineDanger[28][COLOR_NB];
-    int Mobility[4][28][COLOR_NB];
-
-} EvalTrace;
-
 typedef struct TTuple {
     int16_t index, coeff;
 } TTuple;
@@ -118,17 +70,7 @@ typedef double TVector[NTERMS][2];
 typedef int TIntVector[NTERMS][2];
 
 
-extern EvalTrace T;
-
-
 // Runs the tuner
 void Tune();
 
-#else
-#define TRACE (0)
-#define TraceCount(term)
-#define TraceIncr(term)
-#define TraceScale(s)
-#define TraceEval(e)
-#define TraceDanger(d)
 #endif
@@ -25,9 +25,11 @@
 
 #ifdef _MSC_VER
 #define INLINE __forceinline
+#define NOINLINE __declspec(noinline)
 #define CONSTR(prio, func) void func()
 #else
 #define INLINE static inline __attribute__((always_inline))
+#define NOINLINE __attribute__((noinline))
 #define CONSTR(prio, func) static __attribute__((constructor (1000 + prio))) void func()
 #endif
 
@@ -63,6 +65,7 @@ typedef uint64_t Bitboard;
 typedef uint64_t Key;
 
 typedef uint32_t Move;
+typedef uint16_t PackedMove;
 typedef uint32_t Square;
 
 typedef int64_t TimePoint;
@@ -153,5 +156,5 @@ enum { // CastlingRights
 
 typedef struct PV {
     int length;
-    Move line[MAX_PLY];
+    PackedMove line[MAX_PLY];
 } PV;
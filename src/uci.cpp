@@ -22,14 +22,19 @@
 #include "pyrrhic/tbprobe.h"
 #include "noobprobe/noobprobe.h"
 #include "onlinesyzygy/onlinesyzygy.h"
+#include "tuner/trainer.h"
 #include "tuner/tuner.h"
 #include "board.h"
 #include "makemove.h"
+#include "mate.h"
 #include "move.h"
+#include "nnue.h"
+#include "perft.h"
 #include "search.h"
 #include "tests.h"
 #include "threads.h"
 #include "time.h"
+#include "trace.h"
 #include "transposition.h"
 #include "uci.h"
 
@@ -39,6 +44,7 @@ static void ParseTimeControl(const char *str, const Position *pos) {
 
     memset(&Limits, 0, offsetof(SearchLimits, multiPV));
     Limits.start = Now();
+    Limits.startMicro = NowMicro();
 
     // Parse relevant search constraints
     Limits.infinite = strstr(str, "infinite");
@@ -68,6 +74,8 @@ INLINE void Go(Position *pos, char *str) {
     ABORT_SIGNAL = false;
     InitTT();
     ParseTimeControl(str, pos);
+    // Set before starting so a stop right after go waits for the search
+    SEARCH_STOPPED = false;
     StartMainThread(SearchPosition, pos);
 }
 
@@ -88,14 +96,11 @@ static void Pos(Position *pos, char *str) {
     while ((move = strtok(NULL, " "))) {
 
         // Parse and make move
+        ReserveHistory(pos, pos->histPly + 1);
         MakeMove(pos, ParseMove(move, pos));
 
         // Keep track of how many moves have been played
         pos->gameMoves += sideToMove == WHITE;
-
-        // Reset histPly so long games don't go out of bounds of arrays
-        if (pos->rule50 == 0)
-            pos->histPly = 0;
     }
 
     pos->nodes = 0;
@@ -113,14 +118,24 @@ static void SetOption(char *str) {
 
     if      (OptionNameIs("Hash"         )) RequestTTSize(IntValue);
     else if (OptionNameIs("Threads"      )) InitThreads(IntValue);
+    else if (OptionNameIs("PawnHash"     )) PawnHashMB     = IntValue,     InitPawnCaches();
+    else if (OptionNameIs("SharedPawnHash")) SharedPawnHash = BooleanValue, InitPawnCaches();
     else if (OptionNameIs("SyzygyPath"   )) tb_init(optionValue);
     else if (OptionNameIs("MultiPV"      )) Limits.multiPV = IntValue;
+    else if (OptionNameIs("SplitMultiPV" )) SplitMultiPV   = BooleanValue;
     else if (OptionNameIs("Minimal"      )) Minimal        = BooleanValue;
     else if (OptionNameIs("NoobBookLimit")) NoobLimit      = IntValue;
     else if (OptionNameIs("NoobBookMode" )) NoobBookSetMode(optionValue);
     else if (OptionNameIs("NoobBook"     )) NoobBook       = BooleanValue;
     else if (OptionNameIs("UCI_Chess960" )) Chess960       = BooleanValue;
     else if (OptionNameIs("OnlineSyzygy" )) OnlineSyzygy   = BooleanValue;
+    else if (OptionNameIs("MateSolver"   )) MateSolver     = BooleanValue;
+    else if (OptionNameIs("SearchMode"   )) SetSearchMode(optionValue);
+    else if (OptionNameIs("EvalFile"     )) LoadNetwork(optionValue), ClearEvalCaches(), ClearTT();
+    else if (OptionNameIs("UseNNUE"      )) SetUseNNUE(BooleanValue), ClearEvalCaches(), ClearTT();
+#ifdef SEARCH_TRACE
+    else if (OptionNameIs("TraceFile"    )) SetTraceFile(optionValue);
+#endif
     else puts("info string No such option.");
 
     fflush(stdout);
@@ -141,14 +156,24 @@ static void Info() {
     printf("id author Terje Kirstihagen\n");
     printf("option name Hash type spin default %d min %d max %d\n", HASH_DEFAULT, HASH_MIN, HASH_MAX);
     printf("option name Threads type spin default %d min %d max %d\n", 1, 1, 2048);
+    printf("option name PawnHash type spin default %d min %d max %d\n", PAWN_HASH_DEFAULT, PAWN_HASH_MIN, PAWN_HASH_MAX);
+    printf("option name SharedPawnHash type check default false\n");
     printf("option name SyzygyPath type string default <empty>\n");
     printf("option name MultiPV type spin default 1 min 1 max %d\n", MULTI_PV_MAX);
+    printf("option name SplitMultiPV type check default false\n");
     printf("option name Minimal type check default false\n");
     printf("option name UCI_Chess960 type check default false\n");
     printf("option name NoobBook type check default false\n");
     printf("option name NoobBookMode type string default <best>\n");
     printf("option name NoobBookLimit type spin default 0 min 0 max 1000\n");
     printf("option name OnlineSyzygy type check default false\n");
+    printf("option name MateSolver type check default true\n");
+    printf("option name SearchMode type combo default AlphaBeta var AlphaBeta var YBWC var MCTS\n");
+    printf("option name EvalFile type string default <empty>\n");
+    printf("option name UseNNUE type check default true\n");
+#ifdef SEARCH_TRACE
+    printf("option name TraceFile type string default <empty>\n");
+#endif
     printf("uciok\n"); fflush(stdout);
 }
 
@@ -185,6 +210,34 @@ static int HashInput(char *str) {
 // Sets up the engine and follows UCI protocol commands
 int main(int argc, char **argv) {
 
+    // Thread scaling benchmark
+    if (argc > 1 && strstr(argv[1], "smpbench"))
+        return SMPBenchmark(argc, argv), 0;
+
+    // Legality test microbenchmark
+    if (argc > 1 && strstr(argv[1], "legalbench"))
+        return LegalityBenchmark(argc, argv), 0;
+
+    // Move generation microbenchmark
+    if (argc > 1 && strstr(argv[1], "movegenbench"))
+        return MoveGenBenchmark(argc, argv), 0;
+
+    // Make and take back microbenchmark
+    if (argc > 1 && strstr(argv[1], "makebench"))
+        return MakeMoveBenchmark(argc, argv), 0;
+
+    // Perft regression suite
+    if (argc > 1 && strstr(argv[1], "perftsuite"))
+        return PerftSuite(argc, argv);
+
+    // Batch evaluation throughput
+    if (argc > 1 && strstr(argv[1], "evalbench"))
+        return EvalBenchmark(argc, argv), 0;
+
+    // Search trace query
+    if (argc > 1 && strstr(argv[1], "tracequery"))
+        return TraceQuery(argc, argv), 0;
+
     // Benchmark
     if (argc > 1 && strstr(argv[1], "bench"))
         return Benchmark(argc, argv), 0;
@@ -195,14 +248,20 @@ int main(int argc, char **argv) {
         return Tune(), 0;
 #endif
 
+    // Network trainer
+#ifdef TRAIN
+    if (argc > 1 && strstr(argv[1], "train"))
+        return Train(argc, argv), 0;
+#endif
+
     // Init engine
     InitThreads(1);
-    Position pos;
+    Position pos = {};
     ParseFen(START_FEN, &pos);
 
-    // Input loop
+    // Input loop, runs until quit or the end of input
     char str[INPUT_SIZE];
-    while (GetInput(str)) {
+    while (GetInput(str) && HashInput(str) != QUIT) {
         switch (HashInput(str)) {
             case GO         : Go(&pos, str);  break;
             case UCI        : Info();         break;
@@ -211,15 +270,18 @@ int main(int argc, char **argv) {
             case SETOPTION  : SetOption(str); break;
             case UCINEWGAME : NewGame();      break;
             case STOP       : Stop();         break;
-            case QUIT       : Stop();         return 0;
+            case PERFT      : Perft(str);     break;
 #ifdef DEV
             // Non-UCI commands
             case EVAL       : PrintEval(&pos);  break;
             case PRINT      : PrintBoard(&pos); break;
-            case PERFT      : Perft(str);       break;
+            case SEARCHSTATS: PrintLastSearchStats(); break;
 #endif
         }
     }
+
+    Stop();
+    FreePosition(&pos);
 }
 
 // Translates an internal mate score into distance to mate
@@ -239,14 +301,18 @@ void PrintThinking(const Thread *thread, int alpha, int beta) {
     int hashFull      = HashFull();
     int nps           = (int)(1000 * nodes / (elapsed + 1));
 
-    Depth seldepth = 128;
+    Depth seldepth = SEARCH_HISTORY;
     for (; seldepth > 0; --seldepth)
         if (history(seldepth-1).key != 0) break;
 
-    for (int i = 0; i < Limits.multiPV; ++i) {
+    RootMove lines[MULTI_PV_MAX];
+    Depth depths[MULTI_PV_MAX];
+    int count = MergedMultiPV(thread, lines, depths);
+
+    for (int i = 0; i < count; ++i) {
 
-        const PV *pv = &thread->rootMoves[i].pv;
-        int score = thread->rootMoves[i].score;
+        const PV *pv = &lines[i].pv;
+        int score = lines[i].score;
 
         // Skip empty pvs that occur when MultiPV > legal moves in root
         if (pv->length == 0) break;
@@ -268,12 +334,12 @@ void PrintThinking(const Thread *thread, int alpha, int beta) {
         // Basic info
         printf("info depth %d seldepth %d multipv %d score %s %d%s time %" PRId64
                " nodes %" PRIu64 " nps %d tbhits %" PRIu64 " hashfull %d pv",
-                thread->depth, seldepth, i+1, type, score, bound, elapsed,
+                depths[i], seldepth, i+1, type, score, bound, elapsed,
                 nodes, nps, tbhits, hashFull);
 
         // Principal variation
         for (int j = 0; j < pv->length; j++)
-            printf(" %s", MoveToStr(pv->line[j]));
+            printf(" %s", PackedMoveToStr(pv->line[j]));
 
         printf("\n");
     }
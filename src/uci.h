@@ -42,7 +42,8 @@ enum InputCommands {
     // Non-UCI
     EVAL        = 26,
     PRINT       = 112,
-    PERFT       = 116
+    PERFT       = 116,
+    SEARCHSTATS = 111
 };
 
 